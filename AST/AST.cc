@@ -4,7 +4,17 @@
 #include "Tokenizer/Token.h"
 #include <string>
 
-AST_Node::AST_Node(Location const location) : location{location} {}
+namespace
+{
+thread_local long created_count{0};
+} // namespace
+
+AST_Node::AST_Node(Location const location) : location{location}
+{
+    created_count += 1;
+}
+
+long AST_Node::get_created_count() { return created_count; }
 
 AST_BinaryOperation::AST_BinaryOperation(Location const  location,
                                          AST_Expression *lhs,
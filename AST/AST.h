@@ -19,6 +19,9 @@ class AST_Node
     AST_Node(Location const location);
     virtual ~AST_Node(){};
 
+    // NOTE: How many nodes have been created on the calling thread
+    static long get_created_count();
+
     std::string indent(std::vector<bool> is_left_history) const;
 
     void print(std::ostream &os, SymbolTable *symbol_table);
@@ -0,0 +1,1375 @@
+#include "Assembler.h"
+#include "Error/Error.h"
+#include <algorithm>
+#include <cctype>
+#include <climits>
+#include <cstdlib>
+#include <functional>
+
+namespace
+{
+
+struct RegisterName
+{
+    char const *name;
+    int         number;
+    int         size;
+};
+
+// NOTE: The high byte registers ah, ch, dh and bh are left out on purpose,
+// they can't be encoded together with the REX prefix
+RegisterName const REGISTERS[] = {
+    {"rax", 0, 64},   {"rcx", 1, 64},   {"rdx", 2, 64},   {"rbx", 3, 64},
+    {"rsp", 4, 64},   {"rbp", 5, 64},   {"rsi", 6, 64},   {"rdi", 7, 64},
+    {"r8", 8, 64},    {"r9", 9, 64},    {"r10", 10, 64},  {"r11", 11, 64},
+    {"r12", 12, 64},  {"r13", 13, 64},  {"r14", 14, 64},  {"r15", 15, 64},
+    {"eax", 0, 32},   {"ecx", 1, 32},   {"edx", 2, 32},   {"ebx", 3, 32},
+    {"esp", 4, 32},   {"ebp", 5, 32},   {"esi", 6, 32},   {"edi", 7, 32},
+    {"r8d", 8, 32},   {"r9d", 9, 32},   {"r10d", 10, 32}, {"r11d", 11, 32},
+    {"r12d", 12, 32}, {"r13d", 13, 32}, {"r14d", 14, 32}, {"r15d", 15, 32},
+    {"ax", 0, 16},    {"cx", 1, 16},    {"dx", 2, 16},    {"bx", 3, 16},
+    {"sp", 4, 16},    {"bp", 5, 16},    {"si", 6, 16},    {"di", 7, 16},
+    {"r8w", 8, 16},   {"r9w", 9, 16},   {"r10w", 10, 16}, {"r11w", 11, 16},
+    {"r12w", 12, 16}, {"r13w", 13, 16}, {"r14w", 14, 16}, {"r15w", 15, 16},
+    {"al", 0, 8},     {"cl", 1, 8},     {"dl", 2, 8},     {"bl", 3, 8},
+    {"spl", 4, 8},    {"bpl", 5, 8},    {"sil", 6, 8},    {"dil", 7, 8},
+    {"r8b", 8, 8},    {"r9b", 9, 8},    {"r10b", 10, 8},  {"r11b", 11, 8},
+    {"r12b", 12, 8},  {"r13b", 13, 8},  {"r14b", 14, 8},  {"r15b", 15, 8},
+};
+
+bool find_register(std::string const &name, int &number, int &size)
+{
+    for (RegisterName const &reg : REGISTERS)
+    {
+        if (name == reg.name)
+        {
+            number = reg.number;
+            size   = reg.size;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+// NOTE: The condition codes of jcc, cmovcc and setcc, in encoding order
+int condition_code(std::string const &condition)
+{
+    static std::map<std::string, int> const codes{
+        {"o", 0x0},   {"no", 0x1},  {"b", 0x2},   {"c", 0x2},  {"nae", 0x2},
+        {"ae", 0x3},  {"nb", 0x3},  {"nc", 0x3},  {"e", 0x4},  {"z", 0x4},
+        {"ne", 0x5},  {"nz", 0x5},  {"be", 0x6},  {"na", 0x6}, {"a", 0x7},
+        {"nbe", 0x7}, {"s", 0x8},   {"ns", 0x9},  {"p", 0xa},  {"pe", 0xa},
+        {"np", 0xb},  {"po", 0xb},  {"l", 0xc},   {"nge", 0xc}, {"ge", 0xd},
+        {"nl", 0xd},  {"le", 0xe},  {"ng", 0xe},  {"g", 0xf},  {"nle", 0xf},
+    };
+
+    auto it = codes.find(condition);
+    return it == codes.end() ? -1 : it->second;
+}
+
+std::string trim(std::string const &text)
+{
+    std::size_t first = text.find_first_not_of(" \t\r");
+    if (first == std::string::npos)
+    {
+        return "";
+    }
+
+    std::size_t last = text.find_last_not_of(" \t\r");
+    return text.substr(first, last - first + 1);
+}
+
+bool is_quote(char c)
+{
+    return c == '\'' || c == '"' || c == '`';
+}
+
+// NOTE: Splits on commas that aren't inside quotes or brackets
+std::vector<std::string> split_operands(std::string const &arguments)
+{
+    std::vector<std::string> operands{};
+
+    if (trim(arguments).empty())
+    {
+        return operands;
+    }
+
+    std::string current{""};
+    char        quote = 0;
+    int         depth = 0;
+
+    for (char c : arguments)
+    {
+        if (quote != 0)
+        {
+            quote = c == quote ? 0 : quote;
+        }
+        else if (is_quote(c))
+        {
+            quote = c;
+        }
+        else if (c == '[' || c == '(')
+        {
+            depth++;
+        }
+        else if (c == ']' || c == ')')
+        {
+            depth--;
+        }
+        else if (c == ',' && depth == 0)
+        {
+            operands.push_back(trim(current));
+            current.clear();
+            continue;
+        }
+
+        current += c;
+    }
+
+    operands.push_back(trim(current));
+    return operands;
+}
+
+bool fits_in_8_bits(long value)
+{
+    return value >= -128 && value <= 127;
+}
+
+bool fits_in_32_bits(long value)
+{
+    return value >= INT_MIN && value <= INT_MAX;
+}
+
+bool is_identifier_start(char c)
+{
+    return std::isalpha(c) || c == '_' || c == '.';
+}
+
+bool is_identifier_char(char c)
+{
+    return std::isalnum(c) || c == '_' || c == '.' || c == '#' || c == '@' ||
+           c == '$';
+}
+
+} // namespace
+
+void Assembler::assemble(std::istream &is)
+{
+    std::string line{""};
+
+    while (std::getline(is, line))
+    {
+        line_number++;
+        line_text = line;
+
+        assemble_line(line);
+    }
+}
+
+void Assembler::assemble_line(std::string line)
+{
+    // NOTE: Remove the comment, but not semicolons inside of quotes
+    char quote = 0;
+    for (std::size_t i = 0; i < line.size(); i++)
+    {
+        if (quote != 0)
+        {
+            quote = line[i] == quote ? 0 : quote;
+        }
+        else if (is_quote(line[i]))
+        {
+            quote = line[i];
+        }
+        else if (line[i] == ';')
+        {
+            line.erase(i);
+            break;
+        }
+    }
+
+    line = trim(line);
+
+    if (line.empty())
+    {
+        return;
+    }
+
+    std::size_t end   = line.find_first_of(" \t");
+    std::string first = line.substr(0, end);
+    std::string rest  = end == std::string::npos ? "" : trim(line.substr(end));
+
+    if (first.back() == ':')
+    {
+        define_label(first.substr(0, first.size() - 1));
+
+        if (rest.empty())
+        {
+            return;
+        }
+
+        end   = rest.find_first_of(" \t");
+        first = rest.substr(0, end);
+        rest  = end == std::string::npos ? "" : trim(rest.substr(end));
+    }
+
+    // NOTE: Data can be labeled without a colon, like 'buffer resb 64'
+    std::size_t second_end = rest.find_first_of(" \t");
+    std::string second     = rest.substr(0, second_end);
+    std::string arguments =
+        second_end == std::string::npos ? "" : trim(rest.substr(second_end));
+
+    static std::string const data_directives[] = {
+        "db", "dw", "dd", "dq", "resb", "resw", "resd", "resq", "equ"};
+
+    if (std::find(std::begin(data_directives), std::end(data_directives),
+                  second) != std::end(data_directives))
+    {
+        if (second == "equ")
+        {
+            std::string label{""};
+            constants[first] = evaluate(arguments, label);
+
+            if (!label.empty())
+            {
+                error("equ has to be a constant");
+            }
+
+            return;
+        }
+
+        define_label(first);
+        assemble_directive(second, arguments);
+        return;
+    }
+
+    static std::string const directives[] = {
+        "section", "segment", "global", "extern", "default", "bits",
+        "align",   "db",      "dw",     "dd",     "dq",      "resb",
+        "resw",    "resd",    "resq"};
+
+    std::transform(first.begin(), first.end(), first.begin(), ::tolower);
+
+    if (std::find(std::begin(directives), std::end(directives), first) !=
+        std::end(directives))
+    {
+        assemble_directive(first, rest);
+    }
+    else
+    {
+        assemble_instruction(first, rest);
+    }
+}
+
+void Assembler::assemble_directive(std::string const &directive,
+                                   std::string const &arguments)
+{
+    if (directive == "section" || directive == "segment")
+    {
+        if (arguments == ".text")
+        {
+            section = Section::Text;
+        }
+        else if (arguments == ".data" || arguments == ".rodata")
+        {
+            section = Section::Data;
+        }
+        else if (arguments == ".bss")
+        {
+            section = Section::Bss;
+        }
+        else
+        {
+            error("Unknown section");
+        }
+    }
+    else if (directive == "global" || directive == "extern" ||
+             directive == "default" || directive == "bits")
+    {
+        // NOTE: There is only ever one object file, and it's always 64 bit
+    }
+    else if (directive == "align")
+    {
+        std::string label{""};
+        long        alignment = evaluate(arguments, label);
+
+        if (alignment <= 0 || !label.empty())
+        {
+            error("Invalid alignment");
+        }
+
+        while (position() % alignment != 0)
+        {
+            if (section == Section::Bss)
+            {
+                bss_size++;
+            }
+            else
+            {
+                emit(section == Section::Text ? 0x90 : 0x00);
+            }
+        }
+    }
+    else if (directive[0] == 'd')
+    {
+        int size = directive == "db"   ? 1
+                   : directive == "dw" ? 2
+                   : directive == "dd" ? 4
+                                       : 8;
+
+        for (std::string const &operand : split_operands(arguments))
+        {
+            // NOTE: Strings are padded to a whole number of elements
+            if (operand.size() >= 2 && is_quote(operand[0]) &&
+                operand.back() == operand[0] && size == 1)
+            {
+                for (std::size_t i = 1; i + 1 < operand.size(); i++)
+                {
+                    emit((std::uint8_t)operand[i]);
+                }
+
+                continue;
+            }
+
+            std::string label{""};
+            long        value = evaluate(operand, label);
+
+            if (label.empty())
+            {
+                emit(value, size);
+            }
+            else if (size == 4 || size == 8)
+            {
+                emit_label_reference(label, value,
+                                     size == 4 ? Fixup::Kind::Absolute32
+                                               : Fixup::Kind::Absolute64);
+            }
+            else
+            {
+                error("Labels only fit in dd and dq");
+            }
+        }
+    }
+    else
+    {
+        int size = directive == "resb"   ? 1
+                   : directive == "resw" ? 2
+                   : directive == "resd" ? 4
+                                         : 8;
+
+        std::string label{""};
+        long        count = evaluate(arguments, label);
+
+        if (count < 0 || !label.empty())
+        {
+            error("Invalid size");
+        }
+
+        if (section == Section::Bss)
+        {
+            bss_size += count * size;
+        }
+        else
+        {
+            current().resize(current().size() + count * size, 0);
+        }
+    }
+}
+
+void Assembler::assemble_instruction(std::string const &mnemonic,
+                                     std::string const &arguments)
+{
+    std::vector<Operand> operands{};
+    for (std::string const &operand : split_operands(arguments))
+    {
+        operands.push_back(parse_operand(operand));
+    }
+
+    auto expect = [&](std::size_t count)
+    {
+        if (operands.size() != count)
+        {
+            error("Wrong number of operands");
+        }
+    };
+
+    static std::map<std::string, int> const arithmetic{
+        {"add", 0}, {"or", 1},  {"adc", 2}, {"sbb", 3},
+        {"and", 4}, {"sub", 5}, {"xor", 6}, {"cmp", 7},
+    };
+
+    static std::map<std::string, int> const unary{
+        {"not", 2}, {"neg", 3}, {"mul", 4}, {"div", 6}, {"idiv", 7},
+    };
+
+    static std::map<std::string, int> const shifts{
+        {"rol", 0}, {"ror", 1}, {"shl", 4}, {"sal", 4}, {"shr", 5}, {"sar", 7},
+    };
+
+    if (arithmetic.count(mnemonic) == 1)
+    {
+        expect(2);
+        encode_arithmetic(arithmetic.at(mnemonic), operands);
+    }
+    else if (unary.count(mnemonic) == 1 ||
+             (mnemonic == "imul" && operands.size() == 1))
+    {
+        expect(1);
+        encode_unary(0xf7, mnemonic == "imul" ? 5 : unary.at(mnemonic),
+                     operands);
+    }
+    else if (mnemonic == "inc" || mnemonic == "dec")
+    {
+        expect(1);
+        encode_unary(0xff, mnemonic == "inc" ? 0 : 1, operands);
+    }
+    else if (shifts.count(mnemonic) == 1)
+    {
+        expect(2);
+        encode_shift(shifts.at(mnemonic), operands);
+    }
+    else if (mnemonic == "mov")
+    {
+        expect(2);
+        encode_move(operands);
+    }
+    else if (mnemonic == "test")
+    {
+        expect(2);
+
+        Operand const &a = operands[0];
+        Operand const &b = operands[1];
+
+        int size = a.size != 0 ? a.size : b.size;
+
+        if (b.kind == Operand::Kind::Register)
+        {
+            emit_prefixes(size, b.reg, a);
+            emit(size == 8 ? 0x84 : 0x85);
+            emit_modrm(b.reg, a);
+        }
+        else if (b.kind == Operand::Kind::Immediate && size != 0)
+        {
+            emit_prefixes(size, -1, a);
+            emit(size == 8 ? 0xf6 : 0xf7);
+            emit_modrm(0, a);
+            emit_immediate(b, size == 8 ? 1 : size == 16 ? 2 : 4);
+        }
+        else
+        {
+            error("Invalid operands");
+        }
+    }
+    else if (mnemonic == "lea" || mnemonic == "movzx" ||
+             mnemonic == "movsx" || mnemonic == "movsxd" ||
+             (mnemonic == "imul" && operands.size() >= 2) ||
+             (mnemonic.compare(0, 4, "cmov") == 0 &&
+              condition_code(mnemonic.substr(4)) != -1))
+    {
+        // NOTE: All of these take a register as destination and a register
+        // or memory operand as source
+        if (operands.size() < 2 ||
+            operands[0].kind != Operand::Kind::Register ||
+            operands[1].kind == Operand::Kind::Immediate)
+        {
+            error("Invalid operands");
+        }
+
+        Operand const &a = operands[0];
+        Operand const &b = operands[1];
+
+        emit_prefixes(a.size, a.reg, b);
+
+        if (mnemonic == "lea")
+        {
+            emit(0x8d);
+        }
+        else if (mnemonic == "movzx" || mnemonic == "movsx")
+        {
+            emit(0x0f);
+            emit((mnemonic == "movzx" ? 0xb6 : 0xbe) + (b.size == 16));
+        }
+        else if (mnemonic == "movsxd")
+        {
+            emit(0x63);
+        }
+        else if (mnemonic == "imul" && operands.size() == 3)
+        {
+            bool small = operands[2].label.empty() &&
+                         fits_in_8_bits(operands[2].value);
+            emit(small ? 0x6b : 0x69);
+            emit_modrm(a.reg, b);
+            emit_immediate(operands[2], small ? 1 : 4);
+            return;
+        }
+        else if (mnemonic == "imul")
+        {
+            emit(0x0f);
+            emit(0xaf);
+        }
+        else
+        {
+            emit(0x0f);
+            emit(0x40 + condition_code(mnemonic.substr(4)));
+        }
+
+        emit_modrm(a.reg, b);
+    }
+    else if (mnemonic.compare(0, 3, "set") == 0 &&
+             condition_code(mnemonic.substr(3)) != -1)
+    {
+        expect(1);
+        emit_prefixes(8, -1, operands[0]);
+        emit(0x0f);
+        emit(0x90 + condition_code(mnemonic.substr(3)));
+        emit_modrm(0, operands[0]);
+    }
+    else if (mnemonic == "push" || mnemonic == "pop")
+    {
+        expect(1);
+
+        Operand const &a = operands[0];
+
+        if (a.kind == Operand::Kind::Register)
+        {
+            if (a.reg >= 8)
+            {
+                emit(0x41);
+            }
+
+            emit((mnemonic == "push" ? 0x50 : 0x58) + (a.reg & 7));
+        }
+        else if (a.kind == Operand::Kind::Memory)
+        {
+            // NOTE: Pushing and popping is always 64 bit, without REX.W
+            emit_prefixes(32, -1, a);
+            emit(mnemonic == "push" ? 0xff : 0x8f);
+            emit_modrm(mnemonic == "push" ? 6 : 0, a);
+        }
+        else if (mnemonic == "push")
+        {
+            bool small = a.label.empty() && fits_in_8_bits(a.value);
+            emit(small ? 0x6a : 0x68);
+            emit_immediate(a, small ? 1 : 4);
+        }
+        else
+        {
+            error("Invalid operands");
+        }
+    }
+    else if (mnemonic == "call" || mnemonic == "jmp" ||
+             (mnemonic[0] == 'j' && condition_code(mnemonic.substr(1)) != -1))
+    {
+        expect(1);
+        encode_jump(mnemonic, operands[0]);
+    }
+    else if (mnemonic == "cqo")
+    {
+        emit(0x48);
+        emit(0x99);
+    }
+    else if (mnemonic == "cdq")
+    {
+        emit(0x99);
+    }
+    else if (mnemonic == "ret")
+    {
+        emit(0xc3);
+    }
+    else if (mnemonic == "leave")
+    {
+        emit(0xc9);
+    }
+    else if (mnemonic == "nop")
+    {
+        emit(0x90);
+    }
+    else if (mnemonic == "syscall")
+    {
+        emit(0x0f);
+        emit(0x05);
+    }
+    else
+    {
+        error("Unsupported instruction '" + mnemonic + "'");
+    }
+}
+
+void Assembler::define_label(std::string const &name)
+{
+    std::string label = qualified_label(name);
+
+    if (name[0] != '.')
+    {
+        last_label = name;
+    }
+
+    if (labels.count(label) == 1)
+    {
+        error("Label '" + label + "' is defined more than once");
+    }
+
+    labels[label] = {section, position()};
+}
+
+std::string Assembler::qualified_label(std::string const &name) const
+{
+    return name[0] == '.' ? last_label + name : name;
+}
+
+Assembler::Operand Assembler::parse_operand(std::string text) const
+{
+    Operand operand{};
+
+    static std::pair<char const *, int> const sizes[] = {
+        {"qword ", 64}, {"dword ", 32}, {"word ", 16}, {"byte ", 8}};
+
+    for (auto const &size : sizes)
+    {
+        std::string prefix{size.first};
+        if (text.compare(0, prefix.size(), prefix) == 0)
+        {
+            operand.size = size.second;
+            text         = trim(text.substr(prefix.size()));
+        }
+    }
+
+    int number = 0;
+    int size   = 0;
+
+    if (find_register(text, number, size))
+    {
+        operand.kind = Operand::Kind::Register;
+        operand.reg  = number;
+        operand.size = size;
+        return operand;
+    }
+
+    if (text.empty() || text[0] != '[')
+    {
+        operand.kind  = Operand::Kind::Immediate;
+        operand.value = evaluate(text, operand.label);
+        return operand;
+    }
+
+    if (text.back() != ']')
+    {
+        error("Invalid memory operand");
+    }
+
+    operand.kind = Operand::Kind::Memory;
+
+    // NOTE: The address is a sum of a base register, an index register
+    // which may be scaled, and a displacement
+    std::string address = text.substr(1, text.size() - 2);
+    std::size_t start   = 0;
+
+    while (start < address.size())
+    {
+        std::size_t end  = address.find_first_of("+-", start + 1);
+        std::string term = trim(address.substr(start, end - start));
+        int         sign = 1;
+
+        if (!term.empty() && (term[0] == '+' || term[0] == '-'))
+        {
+            sign = term[0] == '-' ? -1 : 1;
+            term = trim(term.substr(1));
+        }
+
+        std::size_t star = term.find('*');
+
+        if (star != std::string::npos)
+        {
+            std::string left  = trim(term.substr(0, star));
+            std::string right = trim(term.substr(star + 1));
+
+            if (!find_register(left, number, size))
+            {
+                std::swap(left, right);
+            }
+
+            std::string label{""};
+            if (!find_register(left, number, size) || operand.index != -1)
+            {
+                error("Invalid memory operand");
+            }
+
+            operand.index = number;
+            operand.scale = evaluate(right, label);
+        }
+        else if (find_register(term, number, size))
+        {
+            if (operand.reg == -1)
+            {
+                operand.reg = number;
+            }
+            else if (operand.index == -1)
+            {
+                operand.index = number;
+            }
+            else
+            {
+                error("Invalid memory operand");
+            }
+        }
+        else
+        {
+            std::string label{""};
+            operand.value += sign * evaluate(term, label);
+
+            if (!label.empty())
+            {
+                if (sign != 1 || !operand.label.empty())
+                {
+                    error("Invalid memory operand");
+                }
+
+                operand.label = label;
+            }
+        }
+
+        start = end;
+    }
+
+    if (operand.index == 4 ||
+        (operand.scale != 1 && operand.scale != 2 && operand.scale != 4 &&
+         operand.scale != 8))
+    {
+        error("Invalid memory operand");
+    }
+
+    return operand;
+}
+
+long Assembler::evaluate(std::string const &text, std::string &label) const
+{
+    // NOTE: Sums and products of numbers, characters and constants, plus at
+    // most one label whose address is filled in at link time
+    std::size_t i = 0;
+
+    auto skip_whitespace = [&]()
+    {
+        while (i < text.size() && (text[i] == ' ' || text[i] == '\t'))
+        {
+            i++;
+        }
+    };
+
+    std::function<long(bool)> factor;
+
+    auto product = [&](bool positive)
+    {
+        long value = factor(positive);
+        skip_whitespace();
+
+        while (i < text.size() && text[i] == '*')
+        {
+            i++;
+            value *= factor(false);
+            skip_whitespace();
+        }
+
+        return value;
+    };
+
+    auto sum = [&](bool positive)
+    {
+        long value = product(positive);
+
+        while (i < text.size() && (text[i] == '+' || text[i] == '-'))
+        {
+            bool minus = text[i++] == '-';
+            long term  = product(positive && !minus);
+            value      = minus ? value - term : value + term;
+        }
+
+        return value;
+    };
+
+    factor = [&](bool positive) -> long
+    {
+        skip_whitespace();
+
+        if (i >= text.size())
+        {
+            error("Expected a value");
+        }
+
+        char c = text[i];
+
+        if (c == '-')
+        {
+            i++;
+            return -(unsigned long)factor(false);
+        }
+
+        if (c == '(')
+        {
+            i++;
+            long value = sum(positive);
+            skip_whitespace();
+
+            if (i >= text.size() || text[i] != ')')
+            {
+                error("Expected ')'");
+            }
+
+            i++;
+            return value;
+        }
+
+        if (is_quote(c))
+        {
+            std::size_t end = text.find(c, i + 1);
+
+            if (end == std::string::npos || end - i - 1 > 8)
+            {
+                error("Invalid character constant");
+            }
+
+            unsigned long value = 0;
+            for (std::size_t j = i + 1; j < end; j++)
+            {
+                value |= (unsigned long)(unsigned char)text[j]
+                         << (8 * (j - i - 1));
+            }
+
+            i = end + 1;
+            return value;
+        }
+
+        if (std::isdigit(c))
+        {
+            std::size_t end = i;
+            while (end < text.size() && std::isalnum(text[end]))
+            {
+                end++;
+            }
+
+            std::string digits = text.substr(i, end - i);
+            int         base   = 10;
+
+            if (digits.size() > 2 && (digits[1] == 'x' || digits[1] == 'X'))
+            {
+                digits = digits.substr(2);
+                base   = 16;
+            }
+            else if (digits.back() == 'h' || digits.back() == 'H')
+            {
+                digits.pop_back();
+                base = 16;
+            }
+
+            char *last  = nullptr;
+            long  value = std::strtoull(digits.c_str(), &last, base);
+
+            if (*last != '\0')
+            {
+                error("Invalid number '" + text.substr(i, end - i) + "'");
+            }
+
+            i = end;
+            return value;
+        }
+
+        if (is_identifier_start(c))
+        {
+            std::size_t end = i;
+            while (end < text.size() && is_identifier_char(text[end]))
+            {
+                end++;
+            }
+
+            std::string name = text.substr(i, end - i);
+            i                = end;
+
+            auto constant = constants.find(name);
+            if (constant != constants.end())
+            {
+                return constant->second;
+            }
+
+            if (!positive || !label.empty())
+            {
+                error("Invalid use of label '" + name + "'");
+            }
+
+            label = qualified_label(name);
+            return 0;
+        }
+
+        error("Invalid expression '" + text + "'");
+        return 0;
+    };
+
+    long value = sum(true);
+    skip_whitespace();
+
+    if (i != text.size())
+    {
+        error("Invalid expression '" + text + "'");
+    }
+
+    return value;
+}
+
+void Assembler::emit_prefixes(int size, int reg, Operand const &rm)
+{
+    if (size == 16)
+    {
+        emit(0x66);
+    }
+
+    std::uint8_t rex = 0x40;
+
+    if (size == 64)
+    {
+        rex |= 0x08;
+    }
+
+    if (reg >= 8)
+    {
+        rex |= 0x04;
+    }
+
+    if (rm.kind == Operand::Kind::Memory && rm.index >= 8)
+    {
+        rex |= 0x02;
+    }
+
+    if (rm.kind != Operand::Kind::Immediate && rm.reg >= 8)
+    {
+        rex |= 0x01;
+    }
+
+    // NOTE: Without a REX prefix, spl, bpl, sil and dil would mean ah, ch, dh
+    // and bh instead
+    bool byte_register =
+        (size == 8 && reg >= 4 && reg < 8) ||
+        (rm.kind == Operand::Kind::Register && rm.size == 8 && rm.reg >= 4 &&
+         rm.reg < 8);
+
+    if (rex != 0x40 || byte_register)
+    {
+        emit(rex);
+    }
+}
+
+void Assembler::emit_modrm(int reg, Operand const &rm)
+{
+    int r = (reg & 7) << 3;
+
+    if (rm.kind == Operand::Kind::Register)
+    {
+        emit(0xc0 | r | (rm.reg & 7));
+        return;
+    }
+
+    if (rm.kind != Operand::Kind::Memory)
+    {
+        error("Invalid operands");
+    }
+
+    int scale = rm.scale == 8 ? 3 : rm.scale == 4 ? 2 : rm.scale == 2 ? 1 : 0;
+    int index = rm.index == -1 ? 4 : rm.index & 7;
+
+    // NOTE: Without a base register the address is an absolute 32 bit
+    // displacement, which is what labels are in a statically linked program
+    if (rm.reg == -1)
+    {
+        emit(0x04 | r);
+        emit(scale << 6 | index << 3 | 5);
+
+        if (rm.label.empty())
+        {
+            emit(rm.value, 4);
+        }
+        else
+        {
+            emit_label_reference(rm.label, rm.value,
+                                 Fixup::Kind::Absolute32);
+        }
+
+        return;
+    }
+
+    int base = rm.reg & 7;
+    int mod  = 0;
+
+    if (!rm.label.empty() || !fits_in_8_bits(rm.value))
+    {
+        mod = 2;
+    }
+    else if (rm.value != 0 || base == 5)
+    {
+        // NOTE: rbp and r13 can't be encoded without a displacement
+        mod = 1;
+    }
+
+    if (rm.index != -1 || base == 4)
+    {
+        emit(mod << 6 | r | 4);
+        emit(scale << 6 | index << 3 | base);
+    }
+    else
+    {
+        emit(mod << 6 | r | base);
+    }
+
+    if (mod == 1)
+    {
+        emit(rm.value, 1);
+    }
+    else if (mod == 2 && rm.label.empty())
+    {
+        emit(rm.value, 4);
+    }
+    else if (mod == 2)
+    {
+        emit_label_reference(rm.label, rm.value, Fixup::Kind::Absolute32);
+    }
+}
+
+void Assembler::emit_immediate(Operand const &immediate, int bytes)
+{
+    if (immediate.kind != Operand::Kind::Immediate)
+    {
+        error("Expected an immediate");
+    }
+
+    if (immediate.label.empty())
+    {
+        emit(immediate.value, bytes);
+    }
+    else if (bytes == 4 || bytes == 8)
+    {
+        emit_label_reference(immediate.label, immediate.value,
+                             bytes == 4 ? Fixup::Kind::Absolute32
+                                        : Fixup::Kind::Absolute64);
+    }
+    else
+    {
+        error("Label doesn't fit in the immediate");
+    }
+}
+
+void Assembler::emit_label_reference(std::string const &label, long addend,
+                                     Fixup::Kind kind)
+{
+    fixups.push_back({kind, section, position(), label, addend});
+    emit(0, kind == Fixup::Kind::Absolute64 ? 8 : 4);
+}
+
+void Assembler::encode_arithmetic(int                         extension,
+                                  std::vector<Operand> const &operands)
+{
+    Operand const &a = operands[0];
+    Operand const &b = operands[1];
+
+    if (b.kind == Operand::Kind::Immediate)
+    {
+        int size = a.size != 0 ? a.size : b.size;
+
+        if (size == 0 || a.kind == Operand::Kind::Immediate)
+        {
+            error("Operation size not specified");
+        }
+
+        bool small = b.label.empty() && fits_in_8_bits(b.value);
+
+        emit_prefixes(size, -1, a);
+        emit(size == 8 ? 0x80 : small ? 0x83 : 0x81);
+        emit_modrm(extension, a);
+        emit_immediate(b, size == 8 || small ? 1 : size == 16 ? 2 : 4);
+    }
+    else if (b.kind == Operand::Kind::Register)
+    {
+        if (a.kind == Operand::Kind::Register && a.size != b.size)
+        {
+            error("Mismatch in operand sizes");
+        }
+
+        emit_prefixes(b.size, b.reg, a);
+        emit(extension * 8 + (b.size == 8 ? 0 : 1));
+        emit_modrm(b.reg, a);
+    }
+    else if (a.kind == Operand::Kind::Register)
+    {
+        emit_prefixes(a.size, a.reg, b);
+        emit(extension * 8 + (a.size == 8 ? 2 : 3));
+        emit_modrm(a.reg, b);
+    }
+    else
+    {
+        error("Invalid operands");
+    }
+}
+
+void Assembler::encode_unary(int opcode, int extension,
+                             std::vector<Operand> const &operands)
+{
+    Operand const &a = operands[0];
+
+    if (a.size == 0 || a.kind == Operand::Kind::Immediate)
+    {
+        error("Operation size not specified");
+    }
+
+    // NOTE: The byte sized version is always the opcode right before
+    emit_prefixes(a.size, -1, a);
+    emit(a.size == 8 ? opcode - 1 : opcode);
+    emit_modrm(extension, a);
+}
+
+void Assembler::encode_shift(int                         extension,
+                             std::vector<Operand> const &operands)
+{
+    Operand const &a = operands[0];
+    Operand const &b = operands[1];
+
+    if (a.size == 0 || a.kind == Operand::Kind::Immediate)
+    {
+        error("Operation size not specified");
+    }
+
+    bool by_cl = b.kind == Operand::Kind::Register && b.reg == 1 &&
+                 b.size == 8;
+    bool by_one =
+        b.kind == Operand::Kind::Immediate && b.label.empty() && b.value == 1;
+
+    if (!by_cl && b.kind != Operand::Kind::Immediate)
+    {
+        error("Invalid operands");
+    }
+
+    emit_prefixes(a.size, -1, a);
+
+    int opcode = by_cl ? 0xd3 : by_one ? 0xd1 : 0xc1;
+    emit(a.size == 8 ? opcode - 1 : opcode);
+    emit_modrm(extension, a);
+
+    if (!by_cl && !by_one)
+    {
+        emit_immediate(b, 1);
+    }
+}
+
+void Assembler::encode_move(std::vector<Operand> const &operands)
+{
+    Operand const &a = operands[0];
+    Operand const &b = operands[1];
+
+    if (a.kind == Operand::Kind::Register &&
+        b.kind == Operand::Kind::Immediate)
+    {
+        // NOTE: 64 bit values that fit are sign extended from 32 bits, which
+        // is also how labels are loaded since the program is linked low
+        if (a.size == 64 && (!b.label.empty() || fits_in_32_bits(b.value)))
+        {
+            emit_prefixes(64, -1, a);
+            emit(0xc7);
+            emit_modrm(0, a);
+            emit_immediate(b, 4);
+            return;
+        }
+
+        emit_prefixes(a.size, -1, a);
+        emit((a.size == 8 ? 0xb0 : 0xb8) + (a.reg & 7));
+        emit_immediate(b, a.size / 8);
+    }
+    else if (a.kind == Operand::Kind::Memory &&
+             b.kind == Operand::Kind::Immediate)
+    {
+        int size = a.size != 0 ? a.size : b.size;
+
+        if (size == 0)
+        {
+            error("Operation size not specified");
+        }
+
+        emit_prefixes(size, -1, a);
+        emit(size == 8 ? 0xc6 : 0xc7);
+        emit_modrm(0, a);
+        emit_immediate(b, size == 8 ? 1 : size == 16 ? 2 : 4);
+    }
+    else if (b.kind == Operand::Kind::Register &&
+             a.kind != Operand::Kind::Immediate)
+    {
+        if (a.kind == Operand::Kind::Register && a.size != b.size)
+        {
+            error("Mismatch in operand sizes");
+        }
+
+        emit_prefixes(b.size, b.reg, a);
+        emit(b.size == 8 ? 0x88 : 0x89);
+        emit_modrm(b.reg, a);
+    }
+    else if (a.kind == Operand::Kind::Register &&
+             b.kind == Operand::Kind::Memory)
+    {
+        emit_prefixes(a.size, a.reg, b);
+        emit(a.size == 8 ? 0x8a : 0x8b);
+        emit_modrm(a.reg, b);
+    }
+    else
+    {
+        error("Invalid operands");
+    }
+}
+
+void Assembler::encode_jump(std::string const &mnemonic,
+                            Operand const     &target)
+{
+    if (target.kind != Operand::Kind::Immediate)
+    {
+        if (mnemonic != "call" && mnemonic != "jmp")
+        {
+            error("Conditional jumps need a label");
+        }
+
+        emit_prefixes(32, -1, target);
+        emit(0xff);
+        emit_modrm(mnemonic == "call" ? 2 : 4, target);
+        return;
+    }
+
+    if (target.label.empty())
+    {
+        error("Jumps need a label");
+    }
+
+    // NOTE: Always uses a 32 bit displacement, so that the size of every
+    // instruction is known right away
+    if (mnemonic == "call")
+    {
+        emit(0xe8);
+    }
+    else if (mnemonic == "jmp")
+    {
+        emit(0xe9);
+    }
+    else
+    {
+        emit(0x0f);
+        emit(0x80 + condition_code(mnemonic.substr(1)));
+    }
+
+    emit_label_reference(target.label, target.value,
+                         Fixup::Kind::Relative32);
+}
+
+void Assembler::link(std::uint64_t text_address, std::uint64_t data_address,
+                     std::uint64_t bss_address)
+{
+    this->text_address = text_address;
+    this->data_address = data_address;
+    this->bss_address  = bss_address;
+
+    line_number = 0;
+
+    for (Fixup const &fixup : fixups)
+    {
+        std::vector<std::uint8_t> &bytes =
+            fixup.section == Section::Text ? text : data;
+        std::uint64_t base =
+            fixup.section == Section::Text ? text_address : data_address;
+
+        long value = get_address(fixup.label) + fixup.addend;
+        int  size  = 4;
+
+        switch (fixup.kind)
+        {
+        case Fixup::Kind::Relative32:
+        {
+            value -= base + fixup.offset + 4;
+            break;
+        }
+        case Fixup::Kind::Absolute32: break;
+        case Fixup::Kind::Absolute64:
+        {
+            size = 8;
+            break;
+        }
+        }
+
+        if (size == 4 && !fits_in_32_bits(value))
+        {
+            error("Address of '" + fixup.label + "' is out of range");
+        }
+
+        for (int i = 0; i < size; i++)
+        {
+            bytes[fixup.offset + i] = (unsigned long)value >> (8 * i);
+        }
+    }
+}
+
+std::vector<std::uint8_t> const &Assembler::get_text() const { return text; }
+
+std::vector<std::uint8_t> const &Assembler::get_data() const { return data; }
+
+std::uint64_t Assembler::get_bss_size() const { return bss_size; }
+
+std::uint64_t Assembler::get_address(std::string const &label) const
+{
+    auto it = labels.find(label);
+
+    if (it == labels.end())
+    {
+        error("Undefined label '" + label + "'");
+    }
+
+    switch (it->second.first)
+    {
+    case Section::Text: return text_address + it->second.second;
+    case Section::Data: return data_address + it->second.second;
+    case Section::Bss:
+    default: return bss_address + it->second.second;
+    }
+}
+
+void Assembler::emit(std::uint8_t byte)
+{
+    current().push_back(byte);
+}
+
+void Assembler::emit(std::uint64_t value, int bytes)
+{
+    for (int i = 0; i < bytes; i++)
+    {
+        emit((std::uint8_t)(value >> (8 * i)));
+    }
+}
+
+std::vector<std::uint8_t> &Assembler::current()
+{
+    if (section == Section::Bss)
+    {
+        error("Only space can be reserved in .bss");
+    }
+
+    return section == Section::Text ? text : data;
+}
+
+std::uint64_t Assembler::position() const
+{
+    switch (section)
+    {
+    case Section::Text: return text.size();
+    case Section::Data: return data.size();
+    case Section::Bss:
+    default: return bss_size;
+    }
+}
+
+void Assembler::error(std::string const &message) const
+{
+    if (line_number == 0)
+    {
+        report_internal_compiler_error("Assembler: " + message);
+    }
+
+    report_internal_compiler_error("Assembler: line " +
+                                   std::to_string(line_number) + ": " +
+                                   message + ": '" + trim(line_text) + "'");
+}
@@ -0,0 +1,138 @@
+#pragma once
+
+#include <cstdint>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+// NOTE: Translates the assembler the code generator emits, together with the
+// print.asm runtime, straight into machine code. Only the subset of nasm
+// syntax and of the instruction set that is actually used is understood.
+class Assembler
+{
+  public:
+    void assemble(std::istream &is);
+
+    // NOTE: Fills in the addresses of labels once every line has been
+    // assembled and the sections have been given their final addresses
+    void link(std::uint64_t text_address, std::uint64_t data_address,
+              std::uint64_t bss_address);
+
+    std::vector<std::uint8_t> const &get_text() const;
+    std::vector<std::uint8_t> const &get_data() const;
+    std::uint64_t                    get_bss_size() const;
+
+    std::uint64_t get_address(std::string const &label) const;
+
+  private:
+    enum class Section
+    {
+        Text,
+        Data,
+        Bss,
+    };
+
+    struct Operand
+    {
+        enum class Kind
+        {
+            Register,
+            Memory,
+            Immediate,
+        };
+
+        Kind kind{Kind::Immediate};
+
+        // NOTE: In bits, 0 if it isn't known. Registers always know their
+        // size, memory and immediates only if they are given as 'qword' etc.
+        int size{0};
+
+        // NOTE: The register, or the base and index of a memory operand. -1
+        // if there is none.
+        int reg{-1};
+        int index{-1};
+        int scale{1};
+
+        // NOTE: The displacement of a memory operand, or the value of an
+        // immediate. Both can refer to a label, which is added at link time.
+        long        value{0};
+        std::string label{""};
+    };
+
+    // NOTE: A place in a section that refers to a label whose address isn't
+    // known until link time
+    struct Fixup
+    {
+        enum class Kind
+        {
+            // NOTE: Relative to the end of the 4 byte field, for jumps
+            Relative32,
+            Absolute32,
+            Absolute64,
+        };
+
+        Kind          kind;
+        Section       section;
+        std::uint64_t offset;
+        std::string   label;
+        long          addend;
+    };
+
+    void assemble_line(std::string line);
+    void assemble_directive(std::string const &directive,
+                            std::string const &arguments);
+    void assemble_instruction(std::string const &mnemonic,
+                              std::string const &arguments);
+
+    void define_label(std::string const &name);
+    std::string qualified_label(std::string const &name) const;
+
+    Operand parse_operand(std::string text) const;
+    long    evaluate(std::string const &text, std::string &label) const;
+
+    // NOTE: Encoding helpers. 'reg' is the register or opcode extension that
+    // goes in the reg field of the ModRM byte, 'rm' the other operand.
+    void emit_prefixes(int size, int reg, Operand const &rm);
+    void emit_modrm(int reg, Operand const &rm);
+    void emit_immediate(Operand const &immediate, int bytes);
+    void emit_label_reference(std::string const &label, long addend,
+                              Fixup::Kind kind);
+
+    void encode_arithmetic(int extension, std::vector<Operand> const &);
+    void encode_unary(int opcode, int extension,
+                      std::vector<Operand> const &);
+    void encode_shift(int extension, std::vector<Operand> const &);
+    void encode_move(std::vector<Operand> const &);
+    void encode_jump(std::string const &mnemonic, Operand const &target);
+
+    void emit(std::uint8_t byte);
+    void emit(std::uint64_t value, int bytes);
+
+    std::vector<std::uint8_t> &current();
+    std::uint64_t              position() const;
+
+    void error(std::string const &message) const;
+
+    std::vector<std::uint8_t> text{};
+    std::vector<std::uint8_t> data{};
+    std::uint64_t             bss_size{0};
+
+    Section section{Section::Text};
+
+    // NOTE: Labels are kept as an offset into their section until link time
+    std::map<std::string, std::pair<Section, std::uint64_t>> labels{};
+    std::map<std::string, long>                              constants{};
+    std::vector<Fixup>                                       fixups{};
+
+    std::uint64_t text_address{0};
+    std::uint64_t data_address{0};
+    std::uint64_t bss_address{0};
+
+    // NOTE: Labels starting with '.' are local to the last label before them
+    std::string last_label{""};
+
+    // NOTE: For error messages
+    int         line_number{0};
+    std::string line_text{""};
+};
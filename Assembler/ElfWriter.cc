@@ -0,0 +1,126 @@
+#include "ElfWriter.h"
+#include "Error/Error.h"
+#include <cstdio>
+#include <fstream>
+#include <sys/stat.h>
+
+namespace
+{
+
+std::uint64_t align(std::uint64_t value, std::uint64_t alignment)
+{
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+} // namespace
+
+ElfWriter::ElfWriter(Assembler &assembler) : assembler{assembler} {}
+
+void ElfWriter::write(std::string const &path, std::string const &executable)
+{
+    // NOTE: Replace the file instead of writing into it, in case the old
+    // executable is still running
+    std::remove(path.c_str());
+
+    std::ofstream os{path, std::ofstream::binary};
+    os << executable;
+
+    if (!os)
+    {
+        report_internal_compiler_error("Could not write '" + path + "'");
+    }
+
+    os.close();
+
+    chmod(path.c_str(), 0755);
+}
+
+void ElfWriter::write(std::ostream &os)
+{
+    int const ELF_HEADER_SIZE     = 64;
+    int const PROGRAM_HEADER_SIZE = 56;
+
+    std::vector<std::uint8_t> const &text = assembler.get_text();
+    std::vector<std::uint8_t> const &data = assembler.get_data();
+
+    // NOTE: The headers share the first page with nothing, code starts on
+    // the next one and data on the page after the code
+    std::uint64_t text_offset = PAGE_SIZE;
+    std::uint64_t data_offset = align(text_offset + text.size(), PAGE_SIZE);
+
+    std::uint64_t text_address = BASE_ADDRESS + text_offset;
+    std::uint64_t data_address = BASE_ADDRESS + data_offset;
+    std::uint64_t bss_address  = align(data_address + data.size(), 16);
+
+    assembler.link(text_address, data_address, bss_address);
+
+    std::uint64_t data_memory_size =
+        bss_address + assembler.get_bss_size() - data_address;
+
+    int segments = data_memory_size > 0 ? 2 : 1;
+
+    image.clear();
+
+    // NOTE: ELF header
+    emit(0x7f, 1);
+    emit('E', 1);
+    emit('L', 1);
+    emit('F', 1);
+    emit(2, 1); // 64 bit
+    emit(1, 1); // Little endian
+    emit(1, 1); // Version
+    emit(0, 9); // System V ABI and padding
+
+    emit(2, 2);    // Executable
+    emit(0x3e, 2); // x86-64
+    emit(1, 4);    // Version
+    emit(assembler.get_address("_start"), 8);
+    emit(ELF_HEADER_SIZE, 8); // Program headers right after this one
+    emit(0, 8);               // No section headers
+    emit(0, 4);               // Flags
+    emit(ELF_HEADER_SIZE, 2);
+    emit(PROGRAM_HEADER_SIZE, 2);
+    emit(segments, 2);
+    emit(64, 2); // Size of a section header
+    emit(0, 2);  // Number of section headers
+    emit(0, 2);  // Index of the section name table
+
+    // NOTE: Code, mapped together with the headers
+    emit(1, 4);     // Loadable
+    emit(4 | 1, 4); // Readable and executable
+    emit(0, 8);
+    emit(BASE_ADDRESS, 8);
+    emit(BASE_ADDRESS, 8);
+    emit(text_offset + text.size(), 8);
+    emit(text_offset + text.size(), 8);
+    emit(PAGE_SIZE, 8);
+
+    // NOTE: Data, where .bss is the part that isn't in the file
+    if (segments == 2)
+    {
+        emit(1, 4);     // Loadable
+        emit(4 | 2, 4); // Readable and writable
+        emit(data_offset, 8);
+        emit(data_address, 8);
+        emit(data_address, 8);
+        emit(data.size(), 8);
+        emit(data_memory_size, 8);
+        emit(PAGE_SIZE, 8);
+    }
+
+    image.resize(text_offset, 0);
+    image.insert(image.end(), text.begin(), text.end());
+    image.resize(data_offset, 0);
+    image.insert(image.end(), data.begin(), data.end());
+
+    os.write((char const *)image.data(), image.size());
+}
+
+void ElfWriter::emit(std::uint64_t value, int bytes)
+{
+    for (int i = 0; i < bytes; i++)
+    {
+        // NOTE: Anything past the eighth byte is padding
+        image.push_back(i < 8 ? value >> (8 * i) : 0);
+    }
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include "Assembler/Assembler.h"
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// NOTE: Writes the assembled program as a statically linked x86-64 Linux
+// executable. Code goes in one read only segment, data and .bss in a
+// writable one after it, and execution starts at _start.
+class ElfWriter
+{
+  public:
+    ElfWriter(Assembler &assembler);
+
+    void write(std::ostream &os);
+
+    // NOTE: Writes an executable that has already been written to memory to
+    // the file 'path'
+    static void write(std::string const &path, std::string const &executable);
+
+  private:
+    void emit(std::uint64_t value, int bytes);
+
+    Assembler &assembler;
+
+    std::vector<std::uint8_t> image{};
+
+    // NOTE: Where ld puts programs by default, which keeps every address
+    // small enough to be used as a 32 bit immediate
+    static constexpr std::uint64_t BASE_ADDRESS = 0x400000;
+    static constexpr std::uint64_t PAGE_SIZE    = 0x1000;
+};
@@ -0,0 +1,247 @@
+#include "Compiler/Compiler.h"
+#include "Options/Options.h"
+#include "Statistics/Statistics.h"
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// NOTE: Compiles generated programs of more and more functions and prints how
+// many lines per second each phase gets through at every size, and how the
+// time of each phase grows with the size of the program. A phase that scales
+// linearly has an exponent of 1, one that is quadratic an exponent of 2.
+//
+// Usage: compile_benchmark [options] [largest number of functions]
+//
+// The options are the same as for madoka, like -O2. --corpus=DIR also writes
+// every program that is compiled to DIR, to be compiled with madoka --stats.
+
+namespace
+{
+
+// NOTE: The smallest program, which is doubled until it has the largest
+// number of functions
+int const FIRST_FUNCTION_COUNT   = 16;
+int const DEFAULT_FUNCTION_COUNT = 4096;
+
+// NOTE: How many times each program is compiled. The fastest time of each
+// phase is the one that is reported.
+int const RUN_COUNT = 3;
+
+int const OVERLOAD_COUNT    = 4;
+int const EXPRESSION_LENGTH = 24;
+
+char const *const PARAMETERS[OVERLOAD_COUNT] = {"a", "b", "c", "d"};
+
+char const *const PHASES[] = {"tokenize", "parse",    "type_check",
+                              "quads",    "optimize", "codegen",
+                              "assemble", "link"};
+
+std::string generate_arguments(std::string const &first, int parameter_count)
+{
+    std::string arguments{first};
+
+    for (int i = 1; i < parameter_count; i++)
+    {
+        arguments += ", " + std::string{PARAMETERS[i]};
+    }
+
+    return arguments;
+}
+
+// NOTE: Every function belongs to a family of OVERLOAD_COUNT overloads that
+// share a name and take from one to OVERLOAD_COUNT parameters. Each of them
+// calls the overload of the previous family with as many parameters, so the
+// calls nest as deep as there are families. Every function has a comment
+// before it and a long expression in it.
+std::string generate_program(int function_count)
+{
+    std::ostringstream os{};
+
+    for (int i = 0; i < function_count; i++)
+    {
+        int family          = i / OVERLOAD_COUNT;
+        int parameter_count = i % OVERLOAD_COUNT + 1;
+
+        os << ";;\n"
+           << "    Function " << i << " of " << function_count
+           << ". Comments are skipped by the tokenizer,\n"
+           << "    but every character of them still has to be read.\n"
+           << ";;\n";
+
+        os << "function f" << family << "(";
+        for (int p = 0; p < parameter_count; p++)
+        {
+            os << (p > 0 ? ", " : "") << PARAMETERS[p] << ": int";
+        }
+        os << ") -> int\n{\n";
+
+        os << "    x: int = " << PARAMETERS[0];
+        for (int j = 1; j < EXPRESSION_LENGTH; j++)
+        {
+            os << (j % 2 == 0 ? " + " : " - ")
+               << PARAMETERS[j % parameter_count] << " * " << j;
+        }
+        os << "; Inline comment\n";
+
+        if (family > 0)
+        {
+            os << "\n    if (a > 0)\n    {\n"
+               << "        x = x + f" << family - 1 << "("
+               << generate_arguments("a / 2", parameter_count) << ")\n"
+               << "    }\n";
+        }
+
+        os << "\n    return x\n}\n\n";
+    }
+
+    int last_family = (function_count - 1) / OVERLOAD_COUNT;
+
+    os << "function main()\n{\n";
+    for (int p = 1; p <= OVERLOAD_COUNT; p++)
+    {
+        os << "    print(f" << last_family << "(1000";
+        for (int i = 1; i < p; i++)
+        {
+            os << ", " << i;
+        }
+        os << "))\n";
+    }
+    os << "}\n";
+
+    return os.str();
+}
+
+// NOTE: Compiles the program the same way madoka does, except that the
+// executable is only written to memory
+Statistics compile(std::string const &program, Options const &options)
+{
+    Statistics statistics{};
+
+    Compiler{options, nullptr, &statistics}.compile(program);
+
+    return statistics;
+}
+
+// NOTE: The slope of the line through the points (log x, log y) that fits
+// them best
+double get_exponent(std::vector<double> const &x, std::vector<double> const &y)
+{
+    double sum_x{0}, sum_y{0}, sum_xx{0}, sum_xy{0};
+    int    n = x.size();
+
+    for (int i = 0; i < n; i++)
+    {
+        double log_x = std::log(x[i]);
+        double log_y = std::log(std::max(y[i], 1e-9));
+
+        sum_x += log_x;
+        sum_y += log_y;
+        sum_xx += log_x * log_x;
+        sum_xy += log_x * log_y;
+    }
+
+    double denominator = n * sum_xx - sum_x * sum_x;
+    return denominator != 0 ? (n * sum_xy - sum_x * sum_y) / denominator : 0;
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    Options options{};
+    options.quiet = true;
+
+    int         function_count = DEFAULT_FUNCTION_COUNT;
+    std::string corpus{};
+
+    for (int i = 1; i < argc; i++)
+    {
+        std::string argument{argv[i]};
+
+        if (argument.rfind("--corpus=", 0) == 0)
+        {
+            corpus = argument.substr(9);
+        }
+        else if (argument[0] != '-')
+        {
+            function_count = std::stoi(argument);
+        }
+        else
+        {
+            parse_option(options, argument);
+        }
+    }
+
+    int const phase_count = std::size(PHASES);
+
+    std::vector<double>              lines{};
+    std::vector<std::vector<double>> times(phase_count + 1);
+
+    std::cout << "Compiling programs of " << FIRST_FUNCTION_COUNT << " to "
+              << function_count << " functions at -O"
+              << options.optimization_level << ", fastest of " << RUN_COUNT
+              << " runs, in thousands of lines per second" << std::endl
+              << std::endl;
+
+    std::cout << std::setw(9) << "lines";
+    for (char const *phase : PHASES)
+    {
+        std::cout << std::setw(11) << phase;
+    }
+    std::cout << std::setw(11) << "total" << std::endl;
+
+    for (int count = FIRST_FUNCTION_COUNT; count <= function_count; count *= 2)
+    {
+        std::string program = generate_program(count);
+
+        if (!corpus.empty())
+        {
+            std::ofstream{corpus + "/functions_" + std::to_string(count) +
+                          ".mdk"}
+                << program;
+        }
+
+        std::vector<double> fastest(phase_count + 1, 1e9);
+
+        for (int run = 0; run < RUN_COUNT; run++)
+        {
+            Statistics statistics = compile(program, options);
+
+            double total{0};
+            for (int i = 0; i < phase_count; i++)
+            {
+                double seconds = statistics.get_time(PHASES[i]);
+
+                fastest[i] = std::min(fastest[i], seconds);
+                total += seconds;
+            }
+
+            fastest[phase_count] = std::min(fastest[phase_count], total);
+        }
+
+        long line_count = std::count(program.begin(), program.end(), '\n');
+        lines.push_back(line_count);
+
+        std::cout << std::setw(9) << line_count << std::fixed
+                  << std::setprecision(1);
+        for (int i = 0; i <= phase_count; i++)
+        {
+            times[i].push_back(fastest[i]);
+            std::cout << std::setw(11)
+                      << line_count / std::max(fastest[i], 1e-9) / 1000;
+        }
+        std::cout << std::endl;
+    }
+
+    std::cout << std::setw(9) << "exponent" << std::setprecision(2);
+    for (int i = 0; i <= phase_count; i++)
+    {
+        std::cout << std::setw(11) << get_exponent(lines, times[i]);
+    }
+    std::cout << std::endl;
+}
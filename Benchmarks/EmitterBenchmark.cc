@@ -0,0 +1,152 @@
+#include "CodeGenerator/Emitter.h"
+#include "CodeGenerator/Instruction.h"
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace std::chrono;
+
+// NOTE: Writes a program of a million instructions, once the way the code
+// generator used to, with every line ended by std::endl, and once through the
+// Emitter. Usage: emitter_benchmark [output file, /dev/null by default]
+
+namespace
+{
+
+int const INSTRUCTION_COUNT = 1000000;
+
+// NOTE: How many instructions the Emitter is flushed after, like it is after
+// every function in the code generator
+int const FUNCTION_SIZE = 64;
+
+std::vector<Instruction> generate_program()
+{
+    std::vector<Instruction> program{};
+    program.reserve(INSTRUCTION_COUNT);
+
+    for (int i = 0; program.size() < INSTRUCTION_COUNT; i++)
+    {
+        std::string label = "L" + std::to_string(i);
+
+        program.emplace_back(Instruction::Kind::Label, label, "function");
+        program.emplace_back(Instruction::Kind::Text, "\t;; add");
+        program.emplace_back(Instruction::Kind::Operation,
+                             "mov rbx, qword [rbp-" + std::to_string(i % 64) +
+                                 "]");
+        program.emplace_back(Instruction::Kind::Operation, "add rbx, r12");
+        program.emplace_back(Instruction::Kind::Operation,
+                             "mov qword [rbp-16], rbx");
+        program.emplace_back(Instruction::Kind::Operation, "cmp rbx, 1");
+        program.emplace_back(Instruction::Kind::Operation, "jne " + label);
+        program.emplace_back(Instruction::Kind::Operation, "ret");
+    }
+
+    return program;
+}
+
+void print_with_endl(std::ostream &os, Instruction const &instruction)
+{
+    switch (instruction.kind)
+    {
+    case Instruction::Kind::Operation:
+    {
+        os << "\t" << instruction.opcode;
+
+        for (int i = 0; i < instruction.operands.size(); i++)
+        {
+            os << (i == 0 ? " " : ", ") << instruction.operands[i];
+        }
+
+        os << std::endl;
+        break;
+    }
+    case Instruction::Kind::Label:
+    {
+        os << instruction.opcode << ":";
+
+        if (!instruction.text.empty())
+        {
+            os << "\t; " << instruction.text;
+        }
+
+        os << std::endl;
+        break;
+    }
+    case Instruction::Kind::Text:
+    {
+        os << instruction.text << std::endl;
+        break;
+    }
+    }
+}
+
+void report(std::string const &name, duration<float> time, std::size_t bytes)
+{
+    std::cout << std::left << std::setw(12) << name << std::right
+              << std::setprecision(4) << std::fixed << time.count()
+              << " seconds, " << std::setprecision(1)
+              << bytes / time.count() / (1 << 20) << " MiB/s" << std::endl;
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    std::string path = argc > 1 ? argv[1] : "/dev/null";
+
+    std::vector<Instruction> program = generate_program();
+
+    std::size_t bytes{0};
+    {
+        std::ostringstream os{};
+        Emitter            emitter{os};
+
+        for (Instruction const &instruction : program)
+        {
+            emitter << instruction;
+        }
+
+        emitter.flush();
+        bytes = os.str().size();
+    }
+    {
+        std::ofstream os{path};
+
+        auto t1 = high_resolution_clock::now();
+
+        for (Instruction const &instruction : program)
+        {
+            print_with_endl(os, instruction);
+        }
+
+        auto t2 = high_resolution_clock::now();
+
+        report("std::endl", t2 - t1, bytes);
+    }
+    {
+        std::ofstream os{path};
+        Emitter       emitter{os};
+
+        auto t1 = high_resolution_clock::now();
+
+        for (int i = 0; i < program.size(); i++)
+        {
+            emitter << program[i];
+
+            if ((i + 1) % FUNCTION_SIZE == 0)
+            {
+                emitter.flush();
+            }
+        }
+
+        emitter.flush();
+        os.flush();
+
+        auto t2 = high_resolution_clock::now();
+
+        report("Emitter", t2 - t1, bytes);
+    }
+}
@@ -0,0 +1,322 @@
+#include "Cache.h"
+#include "Error/Error.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <fcntl.h>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+#include <utime.h>
+#include <vector>
+
+namespace
+{
+
+// NOTE: The version alone doesn't change when the compiler is rebuilt, so
+// the size and modification time of the compiler itself are part of it
+std::string get_compiler_version()
+{
+    std::string version{MADOKA_VERSION};
+
+    struct stat status{};
+    if (stat("/proc/self/exe", &status) == 0)
+    {
+        version += " " + std::to_string(status.st_size) + " " +
+                   std::to_string(status.st_mtim.tv_sec) + "." +
+                   std::to_string(status.st_mtim.tv_nsec);
+    }
+
+    return version;
+}
+
+bool read_file(std::string const &path, std::string &contents)
+{
+    std::ifstream is{path, std::ifstream::binary};
+
+    if (!is)
+    {
+        return false;
+    }
+
+    std::stringstream ss{};
+    ss << is.rdbuf();
+    contents = ss.str();
+
+    return true;
+}
+
+} // namespace
+
+Cache::Cache(std::string const &directory, std::uintmax_t max_size)
+    : directory{directory}, max_size{max_size}
+{}
+
+std::string Cache::get_key(std::string const &source, Options const &options)
+{
+    // NOTE: These either don't write an executable, or print reports while
+    // compiling that a cached executable wouldn't
+    if (options.run || options.interpret || options.emit_assembler ||
+        options.spill_report || options.peephole_report)
+    {
+        return "";
+    }
+
+    return get_options_key(options) + '\n' + source;
+}
+
+std::string Cache::get_options_key(Options const &options)
+{
+    static std::string const version = get_compiler_version();
+
+    std::ostringstream key{};
+    key << "madoka " << version << '\n'
+        << "-O" << options.optimization_level << '\n'
+        << "--calling-convention="
+        << (options.register_arguments ? "sysv" : "stack") << '\n'
+        << "--inline-threshold=" << options.inline_threshold << '\n';
+
+    return key.str();
+}
+
+bool Cache::fetch(std::string const &key, std::string const &output)
+{
+    std::string path = get_path(key);
+    std::string entry{};
+
+    // NOTE: An entry starts with the length of its key as 8 little endian
+    // bytes, then the key and then the executable
+    bool found = read_file(path, entry) && entry.size() >= 8;
+
+    std::uint64_t key_size{0};
+    for (int i = 0; found && i < 8; i++)
+    {
+        key_size |= (std::uint64_t)(unsigned char)entry[i] << (8 * i);
+    }
+
+    found = found && entry.size() >= 8 + key_size &&
+            entry.compare(8, key_size, key) == 0;
+
+    if (!found)
+    {
+        count(0, 1);
+        return false;
+    }
+
+    // NOTE: Replace the file instead of writing into it, in case the old
+    // executable is still running
+    std::remove(output.c_str());
+
+    std::ofstream os{output, std::ofstream::binary};
+    os.write(entry.data() + 8 + key_size, entry.size() - 8 - key_size);
+    os.close();
+
+    if (!os)
+    {
+        report_internal_compiler_error("Could not write '" + output + "'");
+    }
+
+    chmod(output.c_str(), 0755);
+
+    // NOTE: Marks the entry as recently used
+    utime(path.c_str(), nullptr);
+
+    count(1, 0);
+    return true;
+}
+
+void Cache::store(std::string const &key, std::string const &output)
+{
+    std::string executable{};
+    if (!read_file(output, executable))
+    {
+        return;
+    }
+
+    std::string path = get_path(key);
+
+    // NOTE: Written next to the entry and renamed, so that other compilers
+    // never see half of an entry
+    std::ostringstream temporary{};
+    temporary << path << ".tmp." << getpid() << "."
+              << std::hash<std::thread::id>{}(std::this_thread::get_id());
+
+    std::ofstream os{temporary.str(), std::ofstream::binary};
+
+    for (int i = 0; i < 8; i++)
+    {
+        os.put((std::uint64_t)key.size() >> (8 * i));
+    }
+
+    os << key << executable;
+    os.close();
+
+    if (!os || std::rename(temporary.str().c_str(), path.c_str()) != 0)
+    {
+        // NOTE: Not being able to cache something isn't an error
+        std::remove(temporary.str().c_str());
+        return;
+    }
+
+    evict();
+}
+
+void Cache::print_statistics(std::ostream &os)
+{
+    long hits{0};
+    long misses{0};
+
+    std::ifstream is{directory + "/statistics"};
+    is >> hits >> misses;
+
+    std::uintmax_t size{0};
+    int            entries{0};
+
+    std::error_code error{};
+    for (auto const &file :
+         std::filesystem::directory_iterator{directory, error})
+    {
+        if (file.path().extension() == ".entry")
+        {
+            size += file.file_size(error);
+            entries += 1;
+        }
+    }
+
+    long total = hits + misses;
+
+    os << "Cache: " << directory << std::endl;
+    os << "\tHits:     " << hits << std::endl;
+    os << "\tMisses:   " << misses << std::endl;
+    os << "\tHit rate: " << std::setprecision(1) << std::fixed
+       << (total > 0 ? 100.0 * hits / total : 0.0) << "%" << std::endl;
+    os << "\tEntries:  " << entries << " using " << size << " of " << max_size
+       << " bytes" << std::endl;
+}
+
+std::uint64_t Cache::hash(std::string const &text)
+{
+    std::uint64_t h = 0xcbf29ce484222325;
+
+    for (char c : text)
+    {
+        h ^= (unsigned char)c;
+        h *= 0x100000001b3;
+    }
+
+    return h;
+}
+
+std::string Cache::get_default_directory()
+{
+    if (char const *cache_home = std::getenv("XDG_CACHE_HOME"))
+    {
+        return std::string{cache_home} + "/madoka";
+    }
+
+    if (char const *home = std::getenv("HOME"))
+    {
+        return std::string{home} + "/.cache/madoka";
+    }
+
+    return "";
+}
+
+std::string Cache::get_path(std::string const &key) const
+{
+    std::ostringstream path{};
+    path << directory << "/" << std::hex << std::setw(16) << std::setfill('0')
+         << hash(key) << ".entry";
+
+    return path.str();
+}
+
+void Cache::count(int hits, int misses)
+{
+    std::string path = directory + "/statistics";
+
+    int fd = open(path.c_str(), O_RDWR | O_CREAT, 0644);
+    if (fd == -1)
+    {
+        return;
+    }
+
+    flock(fd, LOCK_EX);
+
+    char    buffer[64]{};
+    ssize_t size = read(fd, buffer, sizeof(buffer) - 1);
+
+    long old_hits{0};
+    long old_misses{0};
+    if (size > 0)
+    {
+        std::sscanf(buffer, "%ld %ld", &old_hits, &old_misses);
+    }
+
+    std::string text = std::to_string(old_hits + hits) + " " +
+                       std::to_string(old_misses + misses) + "\n";
+
+    ftruncate(fd, 0);
+    pwrite(fd, text.data(), text.size(), 0);
+
+    flock(fd, LOCK_UN);
+    close(fd);
+}
+
+void Cache::evict()
+{
+    std::lock_guard<std::mutex> lock{mutex};
+
+    struct Entry
+    {
+        std::filesystem::path           path;
+        std::uintmax_t                  size;
+        std::filesystem::file_time_type used;
+    };
+
+    std::vector<Entry> entries{};
+    std::uintmax_t     size{0};
+
+    std::error_code error{};
+    for (auto const &file :
+         std::filesystem::directory_iterator{directory, error})
+    {
+        if (file.path().extension() != ".entry")
+        {
+            continue;
+        }
+
+        Entry entry{file.path(), file.file_size(error),
+                    file.last_write_time(error)};
+
+        if (!error)
+        {
+            entries.push_back(entry);
+            size += entry.size;
+        }
+    }
+
+    if (size <= max_size)
+    {
+        return;
+    }
+
+    std::sort(entries.begin(), entries.end(),
+              [](Entry const &a, Entry const &b) { return a.used < b.used; });
+
+    for (Entry const &entry : entries)
+    {
+        if (size <= max_size)
+        {
+            break;
+        }
+
+        std::filesystem::remove(entry.path, error);
+        size -= entry.size;
+    }
+}
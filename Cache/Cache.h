@@ -0,0 +1,65 @@
+#pragma once
+
+#include "Options/Options.h"
+#include <cstdint>
+#include <mutex>
+#include <ostream>
+#include <string>
+
+// NOTE: Executables that have already been compiled, kept on disk so that
+// compiling a file that hasn't changed is a hash and a copy. An entry is named
+// after the hash of its key, which is the compiler version, the options that
+// change the output and the source. The entry holds the whole key as well, so
+// that two keys with the same hash can't be mixed up.
+//
+// Entries are evicted least recently used first once the cache grows larger
+// than its limit, where using an entry updates its modification time.
+class Cache
+{
+  public:
+    // NOTE: The directory has to exist already
+    Cache(std::string const &directory, std::uintmax_t max_size);
+
+    Cache(Cache const &)            = delete;
+    Cache &operator=(Cache const &) = delete;
+
+    // NOTE: Returns an empty key when the output can't be cached, which is
+    // the case for anything but executables written by the compiler itself
+    static std::string get_key(std::string const &source,
+                               Options const &options);
+
+    // NOTE: The compiler version and the options that change the code that
+    // is generated, which everything that is cached depends on
+    static std::string get_options_key(Options const &options);
+
+    // NOTE: Writes the executable for 'key' to 'output' and returns true if
+    // it is in the cache
+    bool fetch(std::string const &key, std::string const &output);
+
+    void store(std::string const &key, std::string const &output);
+
+    // NOTE: Hits and misses of every compile that has used the cache, and
+    // what it holds right now
+    void print_statistics(std::ostream &os);
+
+    // NOTE: 64 bit FNV-1a, which is what entries are named after
+    static std::uint64_t hash(std::string const &text);
+
+    // NOTE: Where the cache is unless --cache-dir says otherwise, or an
+    // empty string if there is no home directory to put it in
+    static std::string get_default_directory();
+
+  private:
+    std::string get_path(std::string const &key) const;
+
+    // NOTE: Adds to the counters in the statistics file, which is shared with
+    // every other compiler that uses the same cache
+    void count(int hits, int misses);
+
+    void evict();
+
+    std::string    directory;
+    std::uintmax_t max_size;
+
+    std::mutex mutex{};
+};
@@ -0,0 +1,386 @@
+#include "FunctionCache.h"
+#include "Cache/Cache.h"
+#include "SymbolTable/Symbol.h"
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <vector>
+
+namespace
+{
+
+bool is_label_char(char c)
+{
+    return std::isalnum((unsigned char)c) || c == '_' || c == '#' ||
+           c == '.' || c == '@' || c == '$';
+}
+
+void write_number(std::ostream &os, std::uint64_t value)
+{
+    for (int i = 0; i < 8; i++)
+    {
+        os.put(value >> (8 * i));
+    }
+}
+
+void write_string(std::ostream &os, std::string const &text)
+{
+    write_number(os, text.size());
+    os << text;
+}
+
+bool read_number(std::string const &data, std::size_t &position,
+                 std::uint64_t &value)
+{
+    if (data.size() - position < 8)
+    {
+        return false;
+    }
+
+    value = 0;
+    for (int i = 0; i < 8; i++)
+    {
+        value |= (std::uint64_t)(unsigned char)data[position + i] << (8 * i);
+    }
+
+    position += 8;
+    return true;
+}
+
+bool read_string(std::string const &data, std::size_t &position,
+                 std::string &text)
+{
+    std::uint64_t size{0};
+    if (!read_number(data, position, size) || data.size() - position < size)
+    {
+        return false;
+    }
+
+    text = data.substr(position, size);
+    position += size;
+    return true;
+}
+
+} // namespace
+
+FunctionCache::FunctionCache(std::string const &path,
+                             SymbolTable *symbol_table, Options const &options)
+    : path{path}, symbol_table{symbol_table}, options{options}
+{
+    std::ifstream is{path, std::ifstream::binary};
+    if (!is)
+    {
+        return;
+    }
+
+    std::stringstream ss{};
+    ss << is.rdbuf();
+    std::string data = ss.str();
+
+    // NOTE: An entry is its key, the number of labels it created and its
+    // code. A file that can't be read is the same as no file at all.
+    std::size_t position{0};
+    while (position < data.size())
+    {
+        std::string   key{};
+        std::uint64_t label_count{0};
+        Entry         entry{};
+
+        if (!read_string(data, position, key) ||
+            !read_number(data, position, label_count) ||
+            !read_string(data, position, entry.code))
+        {
+            previous.clear();
+            return;
+        }
+
+        entry.label_count = label_count;
+        previous[key]     = entry;
+    }
+}
+
+bool FunctionCache::begin(int function_index, std::string const &text,
+                          std::set<int> const &callees)
+{
+    FunctionSymbol *function =
+        symbol_table->get_function_symbol(function_index);
+
+    std::ostringstream key{};
+    key << Cache::get_options_key(options) << function->name << " "
+        << function->type << '\n'
+        << text;
+
+    // NOTE: Sorted by name, since the order of the symbols can change when
+    // nothing the function depends on does
+    std::vector<std::string> signatures{};
+    for (int callee_index : callees)
+    {
+        if (callee_index == function_index)
+        {
+            continue;
+        }
+
+        FunctionSymbol *callee =
+            symbol_table->get_function_symbol(callee_index);
+
+        std::string signature = callee->name + " " +
+                                std::to_string(callee->type) + " " +
+                                std::to_string(callee->parameter_count);
+
+        auto it = current.find(callee_index);
+        if (options.optimization_level >= 2 && it != current.end())
+        {
+            signature += " " + it->second.fingerprint;
+        }
+
+        signatures.push_back(signature);
+    }
+
+    std::sort(signatures.begin(), signatures.end());
+
+    for (std::string const &signature : signatures)
+    {
+        key << "calls " << signature << '\n';
+    }
+
+    Function &current_function   = current[function_index];
+    current_function             = Function{};
+    current_function.key         = key.str();
+    current_function.first_label = symbol_table->get_label_count();
+
+    char fingerprint[17]{};
+    std::snprintf(fingerprint, sizeof(fingerprint), "%016llx",
+                  (unsigned long long)Cache::hash(current_function.key));
+    current_function.fingerprint = fingerprint;
+
+    auto it = previous.find(current_function.key);
+    if (it == previous.end())
+    {
+        return false;
+    }
+
+    current_function.label_count = it->second.label_count;
+    current_function.code        = it->second.code;
+
+    if (!make_absolute(function_index, current_function, it->second.code,
+                       reused_code))
+    {
+        current_function.code = "";
+        return false;
+    }
+
+    return true;
+}
+
+std::string FunctionCache::reuse(int function_index)
+{
+    Function const &function = current.at(function_index);
+
+    // NOTE: The labels the function created itself have to be taken, so
+    // that no other function gets them
+    while (symbol_table->get_label_count() <
+           function.first_label + function.label_count)
+    {
+        symbol_table->get_next_label();
+    }
+
+    reused_count += 1;
+
+    std::string code{};
+    std::swap(code, reused_code);
+    return code;
+}
+
+void FunctionCache::end(int function_index)
+{
+    Function &function = current.at(function_index);
+
+    function.label_count =
+        symbol_table->get_label_count() - function.first_label;
+}
+
+void FunctionCache::store(int function_index, std::string const &code)
+{
+    auto it = current.find(function_index);
+    if (it == current.end())
+    {
+        return;
+    }
+
+    generated_count += 1;
+
+    if (!make_relative(function_index, it->second, code, it->second.code))
+    {
+        current.erase(it);
+    }
+}
+
+void FunctionCache::save()
+{
+    // NOTE: Written next to the file and renamed, so that a compiler that is
+    // stopped halfway doesn't leave half of a file behind
+    std::string temporary = path + ".tmp";
+
+    std::ofstream os{temporary, std::ofstream::binary};
+
+    for (auto const &[function_index, function] : current)
+    {
+        if (function.code.empty())
+        {
+            continue;
+        }
+
+        write_string(os, function.key);
+        write_number(os, function.label_count);
+        write_string(os, function.code);
+    }
+
+    os.close();
+
+    if (!os || std::rename(temporary.c_str(), path.c_str()) != 0)
+    {
+        std::remove(temporary.c_str());
+    }
+}
+
+int FunctionCache::get_reused_count() const { return reused_count; }
+
+int FunctionCache::get_generated_count() const { return generated_count; }
+
+bool FunctionCache::make_relative(int function_index, Function const &function,
+                                  std::string const &code,
+                                  std::string &relative) const
+{
+    int own_label = symbol_table->get_function_symbol(function_index)->label;
+
+    // NOTE: The names of the functions by their labels, only looked up the
+    // first time a call to another function is found
+    std::map<int, std::string> names{};
+
+    relative.clear();
+    relative.reserve(code.size());
+
+    for (std::size_t i = 0; i < code.size(); i++)
+    {
+        bool is_label =
+            code[i] == 'L' && (i == 0 || !is_label_char(code[i - 1]));
+
+        std::size_t end = i + 1;
+        while (is_label && end < code.size() && std::isdigit(code[end]))
+        {
+            end++;
+        }
+
+        if (!is_label || end == i + 1 ||
+            (end < code.size() && is_label_char(code[end])))
+        {
+            relative.push_back(code[i]);
+            continue;
+        }
+
+        int label = std::stoi(code.substr(i + 1, end - i - 1));
+
+        if (label == own_label)
+        {
+            relative += "L{@}";
+        }
+        else if (label > function.first_label &&
+                 label <= function.first_label + function.label_count)
+        {
+            relative +=
+                "L{+" + std::to_string(label - function.first_label) + "}";
+        }
+        else
+        {
+            if (names.empty())
+            {
+                for (int j = 0; j < symbol_table->get_symbol_count(); j++)
+                {
+                    Symbol *symbol = symbol_table->get_symbol(j);
+                    if (symbol->tag == Symbol::Tag::Function)
+                    {
+                        FunctionSymbol *callee =
+                            symbol_table->get_function_symbol(j);
+                        names[callee->label] = callee->name;
+                    }
+                }
+            }
+
+            auto it = names.find(label);
+            if (it == names.end())
+            {
+                return false;
+            }
+
+            relative += "L{" + it->second + "}";
+        }
+
+        i = end - 1;
+    }
+
+    return true;
+}
+
+bool FunctionCache::make_absolute(int             function_index,
+                                  Function const &function,
+                                  std::string const &relative,
+                                  std::string       &absolute) const
+{
+    int own_label = symbol_table->get_function_symbol(function_index)->label;
+
+    absolute.clear();
+    absolute.reserve(relative.size());
+
+    std::size_t position{0};
+    while (true)
+    {
+        std::size_t begin = relative.find("L{", position);
+        if (begin == std::string::npos)
+        {
+            absolute.append(relative, position);
+            return true;
+        }
+
+        std::size_t end = relative.find('}', begin);
+        if (end == std::string::npos)
+        {
+            return false;
+        }
+
+        absolute.append(relative, position, begin - position);
+
+        std::string name = relative.substr(begin + 2, end - begin - 2);
+
+        int label{-1};
+        if (name.empty())
+        {
+            return false;
+        }
+        else if (name == "@")
+        {
+            label = own_label;
+        }
+        else if (name[0] == '+')
+        {
+            label = function.first_label + std::stoi(name.substr(1));
+        }
+        else
+        {
+            int symbol_index = symbol_table->lookup_symbol(name);
+            if (symbol_index == -1 ||
+                symbol_table->get_symbol(symbol_index)->tag !=
+                    Symbol::Tag::Function)
+            {
+                return false;
+            }
+
+            label = symbol_table->get_function_symbol(symbol_index)->label;
+        }
+
+        absolute += "L" + std::to_string(label);
+        position = end + 1;
+    }
+}
@@ -0,0 +1,94 @@
+#pragma once
+
+#include "Options/Options.h"
+#include "SymbolTable/SymbolTable.h"
+#include <map>
+#include <set>
+#include <string>
+
+// NOTE: The code generated for each function in the previous build of the
+// same output, so that only the functions that have changed since then are
+// generated again.
+//
+// A function can be reused if its fingerprint is the same as last time. The
+// fingerprint is made from the tokens of the function and the signatures of
+// the functions it calls, and at -O2 and above also from their fingerprints,
+// since their bodies may have been inlined or evaluated at compile time.
+//
+// Label numbers change as soon as anything before a function does, so the
+// code is stored with its labels relative to the function. Its own label, the
+// labels it created itself and the labels of the functions it calls are each
+// written differently, and turned back into numbers when the code is reused.
+class FunctionCache
+{
+  public:
+    FunctionCache(std::string const &path, SymbolTable *symbol_table,
+                  Options const &options);
+
+    FunctionCache(FunctionCache const &)            = delete;
+    FunctionCache &operator=(FunctionCache const &) = delete;
+
+    // NOTE: Called once a function has been parsed and type checked, before
+    // any of its quads are generated. Returns true if its code from the
+    // previous build can be reused.
+    bool begin(int function_index, std::string const &text,
+               std::set<int> const &callees);
+
+    // NOTE: The code of a function that begin() said could be reused, with
+    // its labels numbered for this build
+    std::string reuse(int function_index);
+
+    // NOTE: Called once the quads of a function that wasn't reused have been
+    // generated and optimized, and again with its code once it has been
+    // generated
+    void end(int function_index);
+    void store(int function_index, std::string const &code);
+
+    // NOTE: Writes the functions of this build, so that the next build can
+    // reuse them
+    void save();
+
+    // NOTE: How many functions were reused and generated
+    int get_reused_count() const;
+    int get_generated_count() const;
+
+  private:
+    struct Entry
+    {
+        int         label_count{0};
+        std::string code{""};
+    };
+
+    // NOTE: What is known about a function of this build
+    struct Function
+    {
+        std::string key{""};
+        std::string fingerprint{""};
+        int         first_label{0};
+        int         label_count{0};
+        std::string code{""};
+    };
+
+    // NOTE: Turns the labels of a function's code into the relative form and
+    // back, and returns false if a label can't be turned into the other form
+    bool make_relative(int function_index, Function const &function,
+                       std::string const &code, std::string &relative) const;
+    bool make_absolute(int function_index, Function const &function,
+                       std::string const &relative,
+                       std::string &absolute) const;
+
+    std::string  path;
+    SymbolTable *symbol_table;
+    Options      options;
+
+    // NOTE: The functions of the previous build by key, and those of this
+    // build by function index
+    std::map<std::string, Entry> previous{};
+    std::map<int, Function>      current{};
+
+    // NOTE: The code of the function begin() last said could be reused
+    std::string reused_code{""};
+
+    int reused_count{0};
+    int generated_count{0};
+};
@@ -1,66 +1,159 @@
 #include "CodeGenerator.h"
 #include "AST/AST.h"
+#include "CodeGenerator/Runtime.h"
 #include "Error/Error.h"
 #include "SymbolTable/Symbol.h"
 #include "SymbolTable/SymbolTable.h"
-#include <fstream>
+#include <algorithm>
 #include <iostream>
+#include <sstream>
 #include <string>
 
-CodeGenerator::CodeGenerator(std::ostream &out, SymbolTable *symbol_table)
-    : out{out}, symbol_table{symbol_table}
+CodeGenerator::CodeGenerator(std::ostream &out, SymbolTable *symbol_table,
+                             Options const &options, ThreadPool *thread_pool,
+                             FunctionCache *function_cache)
+    : out{out}, emitter{out}, peephole{options}, symbol_table{symbol_table},
+      options{options}, thread_pool{thread_pool},
+      function_cache{function_cache}
 {
-    // TODO: Make sure this path is always accessible
-    std::ifstream is{"../CodeGenerator/print.asm"};
-    out << is.rdbuf() << std::endl;
+    // NOTE: When the program is run right away, print is implemented by the
+    // compiler itself instead of by the runtime
+    if (!options.run && !options.interpret)
+    {
+        emitter << RUNTIME << '\n';
+    }
 
     generate_entry_code();
 }
 
-void CodeGenerator::generate_predefined_functions() const
+CodeGenerator::CodeGenerator(std::ostream &out, CodeGenerator const &parent)
+    : out{out}, emitter{out}, peephole{parent.options},
+      symbol_table{parent.symbol_table}, options{parent.options}
+{
+}
+
+std::string CodeGenerator::get_entry_label() const { return entry_label; }
+
+long CodeGenerator::get_instruction_count() const { return instruction_count; }
+
+void CodeGenerator::generate_predefined_functions()
 {
     // NOTE: Print integer
-    FunctionSymbol *print =
-        symbol_table->get_function_symbol(symbol_table->lookup_symbol(
-            "print#" + std::to_string(symbol_table->type_integer)));
+    function_index = symbol_table->lookup_symbol(
+        "print#" + std::to_string(symbol_table->type_integer));
+    FunctionSymbol *print = symbol_table->get_function_symbol(function_index);
+    omit_frame            = false;
+    memory_used           = memory_size(print, {});
+
     generate_function_prologue(print);
     std::string a1 = address(print->first_parameter);
-    operation("mov rax, [" + a1 + "]");
+    operation("mov rdi, [" + a1 + "]");
     // TODO: When we call print, we want it to automatically call the correct
     // function for printing an integer, a real, a bool or a string. In other
     // words, some sort of function overloading.
+    // NOTE: The runtime follows the System V ABI, so it preserves the callee
+    // saved registers that callers may keep values in
     operation("call __print_integer");
-    out << std::endl;
+    text("");
     generate_function_epilogue(print);
 
     // NOTE: Print bool
-    print = symbol_table->get_function_symbol(symbol_table->lookup_symbol(
-        "print#" + std::to_string(symbol_table->type_bool)));
+    function_index = symbol_table->lookup_symbol(
+        "print#" + std::to_string(symbol_table->type_bool));
+    print       = symbol_table->get_function_symbol(function_index);
+    memory_used = memory_size(print, {});
     generate_function_prologue(print);
     std::string a2 = address(print->first_parameter);
-    operation("mov rax, [" + a2 + "]");
+    operation("mov rdi, [" + a2 + "]");
     // TODO: When we call print, we want it to automatically call the correct
     // function for printing an integer, a real, a bool or a string. In other
     // words, some sort of function overloading.
     operation("call __print_bool");
-    out << std::endl;
+    text("");
     generate_function_epilogue(print);
+
+    flush();
 }
 
 void CodeGenerator::operation(std::string const instruction) const
 {
-    out << "\t" << instruction << std::endl;
+    instructions.push_back(
+        Instruction(Instruction::Kind::Operation, instruction));
 }
 
 void CodeGenerator::label(std::string const name) const
 {
-    out << std::endl << "L" << name << ":" << std::endl;
+    text("");
+    instructions.push_back(Instruction(Instruction::Kind::Label, "L" + name));
 }
 
 void CodeGenerator::label(FunctionSymbol const *function) const
 {
-    out << std::endl
-        << "L" << function->label << ":\t; " << function->name << std::endl;
+    text("");
+    instructions.push_back(Instruction(Instruction::Kind::Label,
+                                       "L" + std::to_string(function->label),
+                                       function->name));
+}
+
+void CodeGenerator::text(std::string const line) const
+{
+    instructions.push_back(Instruction(Instruction::Kind::Text, line));
+}
+
+void CodeGenerator::comment(Quad::Operation operation) const
+{
+    std::ostringstream oss{};
+    oss << "\t;; " << operation;
+    text(oss.str());
+}
+
+void CodeGenerator::flush()
+{
+    if (options.optimization_level >= 1)
+    {
+        peephole.optimize(instructions);
+    }
+
+    for (Instruction const &instruction : instructions)
+    {
+        emitter << instruction;
+
+        if (instruction.kind == Instruction::Kind::Operation)
+        {
+            instruction_count += 1;
+        }
+    }
+
+    emitter.flush();
+    instructions.clear();
+}
+
+void CodeGenerator::finish()
+{
+    if (thread_pool != nullptr)
+    {
+        thread_pool->wait();
+    }
+
+    for (std::shared_ptr<Job> const &job : jobs)
+    {
+        emitter << job->output;
+        peephole.merge(job->peephole);
+        instruction_count += job->instruction_count;
+
+        if (function_cache != nullptr && job->function_index != -1)
+        {
+            function_cache->store(job->function_index, job->output);
+        }
+    }
+
+    emitter.flush();
+    jobs.clear();
+
+    if (options.peephole_report)
+    {
+        peephole.print_report(std::cout);
+    }
 }
 
 std::string CodeGenerator::address(int symbol_index) const
@@ -70,7 +163,7 @@ std::string CodeGenerator::address(int symbol_index) const
     Symbol *symbol = symbol_table->get_symbol(symbol_index);
 
     FunctionSymbol *function =
-        symbol_table->get_function_symbol(symbol_table->enclosing_scope());
+        symbol_table->get_function_symbol(function_index);
 
     // NOTE: Right now, we don't support defining functions inside other
     // functions, so we can only access variables in the current scope
@@ -101,12 +194,28 @@ std::string CodeGenerator::address(int symbol_index) const
         FunctionSymbol *function =
             symbol_table->get_function_symbol(parameter->function);
 
-        // NOTE: The parameters to a function gets pushed onto the stack before
-        // it is called, so we can access them at the top of the prevoius
-        // activation record. But we need to go down 2: one for previous rbp
-        // which is pushed onto the bottom of the stack and one for the return
-        // value then, then we are at the top of the stack.
-        offset = (function->parameter_count - (parameter->index + 1)) * 8 + 16;
+        if (options.register_arguments &&
+            parameter->index < ARGUMENT_REGISTERS)
+        {
+            // NOTE: Parameters passed in registers get a home slot below the
+            // variables in the activation record, in case they are spilled
+            offset = -(function->activation_record_size +
+                       (parameter->index + 1) * 8);
+        }
+        else
+        {
+            // NOTE: The parameters to a function gets pushed onto the stack
+            // before it is called, so we can access them at the top of the
+            // prevoius activation record. But we need to go down 2: one for
+            // previous rbp which is pushed onto the bottom of the stack and one
+            // for the return value then, then we are at the top of the stack.
+            int first_stacked =
+                options.register_arguments ? ARGUMENT_REGISTERS : 0;
+            int stacked_count = function->parameter_count - first_stacked;
+            int stacked_index = parameter->index - first_stacked;
+
+            offset = (stacked_count - (stacked_index + 1)) * 8 + 16;
+        }
     }
     else
     {
@@ -115,21 +224,548 @@ std::string CodeGenerator::address(int symbol_index) const
         return "";
     }
 
-    return (offset > 0 ? "rbp+" : "rbp") + std::to_string(offset);
+    // NOTE: Without a frame rsp stays where the call left it, which is 8
+    // bytes above where rbp would have been
+    std::string base = "rbp";
+
+    if (omit_frame)
+    {
+        base = "rsp";
+        offset -= 8;
+    }
+
+    return (offset > 0 ? base + "+" : base) + std::to_string(offset);
+}
+
+std::string CodeGenerator::location(int symbol_index) const
+{
+    ASSERT(symbol_index != -1);
+
+    auto it = allocation.registers.find(symbol_index);
+
+    if (it != allocation.registers.end())
+    {
+        return it->second;
+    }
+
+    return "[" + address(symbol_index) + "]";
+}
+
+bool CodeGenerator::is_register(std::string const &location) const
+{
+    return location[0] != '[';
+}
+
+std::string CodeGenerator::get_argument_register(int index) const
+{
+    static std::string const registers[ARGUMENT_REGISTERS]{"rdi", "rsi", "rdx",
+                                                           "rcx", "r8",  "r9"};
+
+    ASSERT(index >= 0 && index < ARGUMENT_REGISTERS);
+
+    return registers[index];
+}
+
+void CodeGenerator::store_parameter(int symbol_index) const
+{
+    ParameterSymbol *parameter =
+        symbol_table->get_parameter_symbol(symbol_index);
+
+    ASSERT(parameter->index < ARGUMENT_REGISTERS);
+
+    operation("mov [" + address(symbol_index) + "], " +
+              get_argument_register(parameter->index));
+}
+
+int CodeGenerator::frame_size() const
+{
+    // NOTE: Only the variables that are still in memory and the home slots
+    // that are used need space, see memory_size()
+    int size = memory_used;
+
+    if (options.register_arguments)
+    {
+        // NOTE: The call pushed the return address and the prologue pushes
+        // rbp, which leaves rsp 16 byte aligned. Keep it that way after the
+        // callee saved registers are pushed, so that every call site is
+        // aligned as the System V ABI requires.
+        int pushed = allocation.callee_saved.size() * 8;
+        size       = (size + pushed + 15) / 16 * 16 - pushed;
+    }
+
+    return size;
+}
+
+int CodeGenerator::memory_size(FunctionSymbol const    *function,
+                               std::vector<Quad *> const &quads) const
+{
+    // NOTE: Most of the activation record goes unused once variables are
+    // allocated to registers, so only count how far below rbp the ones that
+    // are still in memory reach
+    int size = 0;
+
+    auto reach = [&](long symbol_index)
+    {
+        if (symbol_index == -1 || allocation.registers.count(symbol_index))
+        {
+            return;
+        }
+
+        Symbol *symbol = symbol_table->get_symbol(symbol_index);
+
+        if (symbol->tag == Symbol::Tag::Variable)
+        {
+            VariableSymbol *variable =
+                symbol_table->get_variable_symbol(symbol_index);
+            size = std::max(size, variable->offset + 8);
+        }
+    };
+
+    for (Quad const *quad : quads)
+    {
+        for (long use : quad->uses())
+        {
+            reach(use);
+        }
+
+        reach(quad->definition());
+    }
+
+    // NOTE: Parameters passed in registers without a register of their own
+    // are stored in their home slot by the prologue
+    int parameter = function->first_parameter;
+    while (options.register_arguments && parameter != -1)
+    {
+        ParameterSymbol *symbol = symbol_table->get_parameter_symbol(parameter);
+
+        if (symbol->index < ARGUMENT_REGISTERS &&
+            allocation.registers.count(parameter) == 0)
+        {
+            size = std::max(size, function->activation_record_size +
+                                      (symbol->index + 1) * 8);
+        }
+
+        parameter = symbol->next_parameter;
+    }
+
+    return size;
+}
+
+bool CodeGenerator::can_omit_frame(int function_index) const
+{
+    if (options.optimization_level < 1 ||
+        !call_graph.at(function_index).empty())
+    {
+        return false;
+    }
+
+    // NOTE: The slot where rbp would have been saved is left unused, so that
+    // variables have the same offsets as with a frame
+    int size = 8 + memory_used + allocation.callee_saved.size() * 8;
+
+    return size <= RED_ZONE_SIZE;
+}
+
+std::string CodeGenerator::saved_register_address(int index) const
+{
+    ASSERT(omit_frame);
+
+    return "rsp-" + std::to_string(8 + memory_used + (index + 1) * 8);
+}
+
+void CodeGenerator::parallel_move(
+    std::vector<std::pair<std::string, std::string>> moves) const
+{
+    moves.erase(std::remove_if(moves.begin(), moves.end(),
+                               [](auto const &move)
+                               { return move.first == move.second; }),
+                moves.end());
+
+    while (!moves.empty())
+    {
+        // NOTE: A move is safe to do once no other move still needs to read
+        // its destination
+        auto ready = std::find_if(
+            moves.begin(), moves.end(),
+            [&](auto const &move)
+            {
+                return std::none_of(moves.begin(), moves.end(),
+                                    [&](auto const &other)
+                                    { return other.second == move.first; });
+            });
+
+        if (ready != moves.end())
+        {
+            operation("mov " + ready->first + ", " + ready->second);
+            moves.erase(ready);
+            continue;
+        }
+
+        // NOTE: Every remaining move is part of a cycle, so we break it by
+        // copying one of the destinations out of the way first
+        std::string blocked = moves.front().first;
+        operation("mov r10, " + blocked);
+
+        for (auto &move : moves)
+        {
+            if (move.second == blocked)
+            {
+                move.second = "r10";
+            }
+        }
+    }
+}
+
+void CodeGenerator::generate_function_call_code(Quad const *quad)
+{
+    FunctionSymbol *function =
+        symbol_table->get_function_symbol(quad->operand1);
+
+    int stacked_arguments = 0;
+
+    if (options.register_arguments)
+    {
+        ASSERT(pending_arguments.size() == function->parameter_count);
+
+        stacked_arguments =
+            std::max(function->parameter_count - ARGUMENT_REGISTERS, 0);
+
+        // NOTE: Keep the stack 16 byte aligned at the call
+        if (stacked_arguments % 2 == 1)
+        {
+            operation("sub rsp, 8");
+        }
+
+        for (int i = ARGUMENT_REGISTERS; i < pending_arguments.size(); i++)
+        {
+            std::string argument = location(pending_arguments[i]);
+            operation("push " +
+                      (is_register(argument) ? argument : "qword " + argument));
+        }
+
+        std::vector<std::pair<std::string, std::string>> moves{};
+        for (int i = 0; i < pending_arguments.size() && i < ARGUMENT_REGISTERS;
+             i++)
+        {
+            moves.push_back(
+                {get_argument_register(i), location(pending_arguments[i])});
+        }
+
+        parallel_move(moves);
+
+        pending_arguments.clear();
+
+        stacked_arguments += stacked_arguments % 2;
+    }
+    else
+    {
+        stacked_arguments = function->parameter_count;
+    }
+
+    operation("call L" + std::to_string(function->label));
+
+    if (stacked_arguments > 0)
+    {
+        // NOTE: Before we call this function we have pushed all the arguments
+        // on top of the stack, but after we return we don't need them anymore
+        // and can safely decrease the stack pointer
+        operation("add rsp, " + std::to_string(stacked_arguments * 8));
+    }
+
+    // NOTE: Only store return value on stack if the function actually returns
+    // a value.
+    if (function->type != symbol_table->type_void)
+    {
+        ASSERT(quad->dest != -1);
+
+        store(quad->dest, "rax");
+    }
+}
+
+bool CodeGenerator::can_tail_call(FunctionSymbol const *caller,
+                                  FunctionSymbol const *callee) const
+{
+    // NOTE: A tail call reuses the return address of the caller, so the callee
+    // has to find its stacked arguments where the caller found its own. That
+    // only works if they fit in the caller's incoming argument area.
+    if (options.register_arguments)
+    {
+        return callee->parameter_count <= ARGUMENT_REGISTERS;
+    }
+
+    return callee->parameter_count <= caller->parameter_count;
+}
+
+void CodeGenerator::generate_tail_call_code(FunctionSymbol *caller,
+                                            Quad const     *quad)
+{
+    FunctionSymbol *callee = symbol_table->get_function_symbol(quad->operand1);
+
+    if (options.register_arguments)
+    {
+        std::vector<std::pair<std::string, std::string>> moves{};
+        for (int i = 0; i < pending_arguments.size(); i++)
+        {
+            moves.push_back(
+                {get_argument_register(i), location(pending_arguments[i])});
+        }
+
+        parallel_move(moves);
+
+        pending_arguments.clear();
+    }
+    else
+    {
+        // NOTE: The ARGUMENT quads have already pushed the arguments, now we
+        // pop them into the lowest slots of our own incoming arguments, which
+        // is where the callee will look for them
+        int count = callee->parameter_count;
+        for (int i = count - 1; i >= 0; i--)
+        {
+            int offset = (count - (i + 1)) * 8 + 16;
+            operation("pop qword [rbp+" + std::to_string(offset) + "]");
+        }
+    }
+
+    generate_frame_teardown(caller);
+    operation("jmp L" + std::to_string(callee->label));
 }
 
 void CodeGenerator::load(std::string reg, int symbol_index) const
 {
     ASSERT(symbol_index != -1);
 
-    operation("mov " + reg + ", [" + address(symbol_index) + "]");
+    std::string source = location(symbol_index);
+
+    if (source != reg)
+    {
+        operation("mov " + reg + ", " + source);
+    }
 }
 
 void CodeGenerator::store(int symbol_index, std::string reg) const
 {
     ASSERT(symbol_index != -1);
 
-    operation("mov [" + address(symbol_index) + "], " + reg);
+    std::string dest = location(symbol_index);
+
+    if (dest != reg)
+    {
+        operation("mov " + dest + ", " + reg);
+    }
+}
+
+void CodeGenerator::generate_binary_operation_code(Quad const        *quad,
+                                                   std::string const &instr,
+                                                   bool commutative) const
+{
+    ASSERT(quad->operand1 != -1);
+    ASSERT(quad->operand2 != -1);
+    ASSERT(quad->dest != -1);
+
+    std::string dest     = location(quad->dest);
+    std::string operand1 = location(quad->operand1);
+    std::string operand2 = location(quad->operand2);
+
+    // NOTE: x86 only has two operand instructions, so when the destination is
+    // a register we compute the result directly in it. That is only possible
+    // if it doesn't also hold the second operand, which would be overwritten
+    // before we read it.
+    if (is_register(dest) && dest != operand2)
+    {
+        load(dest, quad->operand1);
+        operation(instr + " " + dest + ", " + operand2);
+    }
+    else if (is_register(dest) && commutative)
+    {
+        operation(instr + " " + dest + ", " + operand1);
+    }
+    else
+    {
+        load("r10", quad->operand1);
+        operation(instr + " r10, " + operand2);
+        store(quad->dest, "r10");
+    }
+}
+
+namespace
+{
+
+int count_trailing_zeros(unsigned long value)
+{
+    int count = 0;
+    while (count < 64 && (value & 1) == 0)
+    {
+        value >>= 1;
+        count += 1;
+    }
+
+    return count;
+}
+
+// NOTE: Finds the multiplier and shift that turn signed division by the given
+// divisor into a multiplication, from Hacker's Delight (chapter 10). The
+// divisor can't be 0, 1, -1 or a power of two.
+void signed_division_magic(long divisor, long &multiplier, int &shift)
+{
+    unsigned long const two63 = 1UL << 63;
+
+    unsigned long ad  = divisor < 0 ? -(unsigned long)divisor : divisor;
+    unsigned long t   = two63 + ((unsigned long)divisor >> 63);
+    unsigned long anc = t - 1 - t % ad;
+
+    int           p  = 63;
+    unsigned long q1 = two63 / anc;
+    unsigned long r1 = two63 - q1 * anc;
+    unsigned long q2 = two63 / ad;
+    unsigned long r2 = two63 - q2 * ad;
+    unsigned long delta;
+
+    do
+    {
+        p += 1;
+
+        q1 *= 2;
+        r1 *= 2;
+        if (r1 >= anc)
+        {
+            q1 += 1;
+            r1 -= anc;
+        }
+
+        q2 *= 2;
+        r2 *= 2;
+        if (r2 >= ad)
+        {
+            q2 += 1;
+            r2 -= ad;
+        }
+
+        delta = ad - r2;
+    } while (q1 < delta || (q1 == delta && r1 == 0));
+
+    multiplier = q2 + 1;
+    if (divisor < 0)
+    {
+        multiplier = -multiplier;
+    }
+
+    shift = p - 64;
+}
+
+} // namespace
+
+void CodeGenerator::generate_multiplication_by_constant(Quad const *quad) const
+{
+    long        factor = quad->operand2;
+    std::string dest   = location(quad->dest);
+    std::string reg    = is_register(dest) ? dest : "rax";
+
+    unsigned long magnitude = factor < 0 ? -(unsigned long)factor : factor;
+    int           shift     = count_trailing_zeros(magnitude);
+    unsigned long odd       = magnitude >> shift;
+
+    // NOTE: lea can multiply by 3, 5 and 9 in a single cycle, and together
+    // with a shift and a negation that covers a lot of common factors
+    if (odd == 1 || odd == 3 || odd == 5 || odd == 9)
+    {
+        load(reg, quad->operand1);
+
+        if (odd != 1)
+        {
+            operation("lea " + reg + ", [" + reg + " + " + reg + "*" +
+                      std::to_string(odd - 1) + "]");
+        }
+
+        if (shift > 0)
+        {
+            operation("shl " + reg + ", " + std::to_string(shift));
+        }
+
+        if (factor < 0)
+        {
+            operation("neg " + reg);
+        }
+    }
+    else if (factor == (int)factor)
+    {
+        std::string operand = location(quad->operand1);
+
+        operation("imul " + reg + ", " +
+                  (is_register(operand) ? operand : "qword " + operand) +
+                  ", " + std::to_string(factor));
+    }
+    else
+    {
+        load(reg, quad->operand1);
+        operation("mov r10, " + std::to_string(factor));
+        operation("imul " + reg + ", r10");
+    }
+
+    store(quad->dest, reg);
+}
+
+void CodeGenerator::generate_division_by_constant(Quad const *quad) const
+{
+    long divisor = quad->operand2;
+
+    unsigned long magnitude = divisor < 0 ? -(unsigned long)divisor : divisor;
+
+    if ((magnitude & (magnitude - 1)) == 0)
+    {
+        // NOTE: An arithmetic shift rounds towards negative infinity, but
+        // division rounds towards zero. Adding 2^k - 1 to negative dividends
+        // first makes up for it, and cqo gives us exactly that mask in rdx.
+        int shift = count_trailing_zeros(magnitude);
+
+        load("rax", quad->operand1);
+        operation("cqo");
+        operation("shr rdx, " + std::to_string(64 - shift));
+        operation("add rax, rdx");
+        operation("sar rax, " + std::to_string(shift));
+
+        if (divisor < 0)
+        {
+            operation("neg rax");
+        }
+
+        store(quad->dest, "rax");
+
+        return;
+    }
+
+    long multiplier;
+    int  shift;
+    signed_division_magic(divisor, multiplier, shift);
+
+    std::string dividend = location(quad->operand1);
+    std::string operand =
+        is_register(dividend) ? dividend : "qword " + dividend;
+
+    // NOTE: The high half of dividend * multiplier, which imul leaves in rdx,
+    // is the quotient up to a correction for negative results
+    operation("mov rax, " + std::to_string(multiplier));
+    operation("imul " + operand);
+
+    if (divisor > 0 && multiplier < 0)
+    {
+        operation("add rdx, " + operand);
+    }
+    else if (divisor < 0 && multiplier > 0)
+    {
+        operation("sub rdx, " + operand);
+    }
+
+    if (shift > 0)
+    {
+        operation("sar rdx, " + std::to_string(shift));
+    }
+
+    operation("mov rax, rdx");
+    operation("shr rax, 63");
+    operation("add rdx, rax");
+
+    store(quad->dest, "rdx");
 }
 
 void CodeGenerator::generate_comparison_code(Quad const        *quad,
@@ -141,80 +777,324 @@ void CodeGenerator::generate_comparison_code(Quad const        *quad,
 
     // NOTE: Store either 0 (false) or 1 (true), as the result of the comparison
 
-    load("rax", quad->operand1);
-    load("rbx", quad->operand2);
-
     operation("mov rcx, 0");
     operation("mov rdx, 1");
 
-    operation("cmp rax, rbx");
+    compare_operands(quad);
     operation(instr + " rcx, rdx");
 
     store(quad->dest, "rcx");
 }
 
+void CodeGenerator::compare_operands(Quad const *quad) const
+{
+    std::string operand1 = location(quad->operand1);
+    std::string operand2 = location(quad->operand2);
+
+    // NOTE: cmp can't compare two memory operands
+    if (!is_register(operand1) && !is_register(operand2))
+    {
+        load("r10", quad->operand1);
+        operand1 = "r10";
+    }
+
+    operation("cmp " + operand1 + ", " + operand2);
+}
+
+bool CodeGenerator::is_fusable_comparison(std::vector<Quad *> const &quads,
+                                          int quad_index) const
+{
+    // NOTE: A comparison whose only use is the IF right after it doesn't need
+    // its result materialized as a bool, we can branch on the flags directly
+    if (options.optimization_level == 0 || quad_index + 1 >= quads.size())
+    {
+        return false;
+    }
+
+    Quad const *comparison = quads[quad_index];
+    Quad const *branch     = quads[quad_index + 1];
+
+    switch (comparison->operation)
+    {
+    case Quad::Operation::LESSER_THAN:
+    case Quad::Operation::LESSER_THAN_OR_EQUAL:
+    case Quad::Operation::EQUAL:
+    case Quad::Operation::GREATER_THAN:
+    case Quad::Operation::GREATER_THAN_OR_EQUAL: break;
+    default: return false;
+    }
+
+    if (branch->operation != Quad::Operation::IF ||
+        branch->operand1 != comparison->dest)
+    {
+        return false;
+    }
+
+    return use_counts.at(comparison->dest) == 1;
+}
+
+std::string CodeGenerator::inverted_jump(Quad::Operation operation) const
+{
+    // NOTE: IF jumps past its body when the condition is false
+    switch (operation)
+    {
+    case Quad::Operation::LESSER_THAN: return "jge";
+    case Quad::Operation::LESSER_THAN_OR_EQUAL: return "jg";
+    case Quad::Operation::EQUAL: return "jne";
+    case Quad::Operation::GREATER_THAN: return "jle";
+    case Quad::Operation::GREATER_THAN_OR_EQUAL: return "jl";
+    default:
+    {
+        report_internal_compiler_error(
+            "inverted_jump(): Quad is not a comparison");
+        return "";
+    }
+    }
+}
+
+void CodeGenerator::allocate_registers(FunctionSymbol const      *function,
+                                       std::vector<Quad *> const &quads)
+{
+    // NOTE: At -O0 every variable lives in memory, above that we run a
+    // register allocator over each function before generating its code
+    LinearScanAllocator    linear_scan{symbol_table};
+    GraphColoringAllocator graph_coloring{symbol_table};
+
+    if (options.optimization_level >= 3)
+    {
+        allocation = graph_coloring.allocate(function_index, quads);
+    }
+    else if (options.optimization_level >= 1)
+    {
+        allocation = linear_scan.allocate(function_index, quads);
+    }
+    else
+    {
+        allocation = Allocation{};
+    }
+
+    if (options.spill_report)
+    {
+        int linear_scan_spills =
+            linear_scan.allocate(function_index, quads).spill_count;
+        int graph_coloring_spills =
+            graph_coloring.allocate(function_index, quads).spill_count;
+
+        std::cout << "Spills in '" << function->name
+                  << "': linear scan " << linear_scan_spills
+                  << ", graph coloring " << graph_coloring_spills
+                  << std::endl;
+    }
+}
+
 void CodeGenerator::generate_code(Quads &quads)
 {
+    int function_index = symbol_table->enclosing_scope();
+
+    std::vector<Quad *> function_quads{};
+
+    for (Quad *quad = quads.get_current_quad(); quad != nullptr;
+         quad       = quads.get_current_quad())
+    {
+        function_quads.push_back(quad);
+    }
+
+    // NOTE: The spill report is printed while generating, so it would come
+    // out in a different order every time if functions were generated in
+    // parallel
+    bool serial = thread_pool == nullptr || options.spill_report;
+
+    if (serial && function_cache == nullptr)
+    {
+        generate_function(function_index, function_quads);
+        return;
+    }
+
+    // NOTE: By now the quads of the function are final, and the symbols
+    // the code generator reads won't change anymore, so the rest can be done
+    // on another thread. The output is put back in order in finish(). With a
+    // function cache, the code is kept apart even without a thread pool, so
+    // that it can be stored.
+    std::shared_ptr<Job> job = std::make_shared<Job>();
+    job->function_index      = function_index;
+    jobs.push_back(job);
+
+    auto generate = [this, job, function_index, function_quads]
+    {
+        std::ostringstream os{};
+
+        CodeGenerator code_generator{os, *this};
+        code_generator.generate_function(function_index, function_quads);
+
+        job->output            = os.str();
+        job->peephole          = code_generator.peephole;
+        job->instruction_count = code_generator.instruction_count;
+    };
+
+    if (serial)
+    {
+        generate();
+    }
+    else
+    {
+        thread_pool->submit(generate);
+    }
+}
+
+void CodeGenerator::reuse_code(std::string const &code)
+{
+    std::shared_ptr<Job> job = std::make_shared<Job>();
+    job->output              = code;
+    jobs.push_back(job);
+}
+
+void CodeGenerator::generate_function(int                        function_index,
+                                      std::vector<Quad *> const &function_quads)
+{
+    this->function_index = function_index;
+
     FunctionSymbol *function =
-        symbol_table->get_function_symbol(symbol_table->enclosing_scope());
+        symbol_table->get_function_symbol(function_index);
 
-    generate_function_prologue(function);
+    // NOTE: Functions are defined before they are used, so by the time a
+    // function is generated everything it calls has been generated already
+    std::set<int> &callees = call_graph[function_index];
+
+    for (Quad const *quad : function_quads)
+    {
+        if (quad->operation == Quad::Operation::FUNCTION_CALL)
+        {
+            callees.insert(quad->operand1);
+        }
+    }
 
-    Quad *quad = quads.get_current_quad();
+    allocate_registers(function, function_quads);
 
-    while (quad != nullptr)
+    memory_used = memory_size(function, function_quads);
+    omit_frame  = can_omit_frame(function_index);
+
+    use_counts.clear();
+    for (Quad const *quad : function_quads)
     {
+        for (long use : quad->uses())
+        {
+            use_counts[use] += 1;
+        }
+    }
+
+    generate_function_prologue(function);
+
+    for (int i = 0; i < function_quads.size(); i++)
+    {
+        Quad *quad = function_quads[i];
+
+#if MA_ASM_COM == 1
+        comment(quad->operation);
+#endif
+
+        if (is_fusable_comparison(function_quads, i))
+        {
+            Quad *branch = function_quads[++i];
 
 #if MA_ASM_COM == 1
-        out << "\t;; " << quad->operation << std::endl;
+            comment(branch->operation);
 #endif
 
+            compare_operands(quad);
+            operation(inverted_jump(quad->operation) + " L" +
+                      std::to_string(branch->operand2));
+
+#if MA_ASM_COM == 1
+            text("");
+#endif
+
+            continue;
+        }
+
         switch (quad->operation)
         {
         case Quad::Operation::ASSIGN:
         {
-            load("r10", quad->operand1);
-            store(quad->dest, "r10");
+            if (is_register(location(quad->dest)))
+            {
+                load(location(quad->dest), quad->operand1);
+            }
+            else if (is_register(location(quad->operand1)))
+            {
+                store(quad->dest, location(quad->operand1));
+            }
+            else
+            {
+                load("r10", quad->operand1);
+                store(quad->dest, "r10");
+            }
 
             break;
         }
         case Quad::Operation::ARGUMENT:
         {
-            load("r10", quad->operand1);
-            operation("push r10");
+            // NOTE: The ARGUMENT quads come right before their FUNCTION_CALL,
+            // which moves them all into place at once
+            if (options.register_arguments)
+            {
+                pending_arguments.push_back(quad->operand1);
+            }
+            else if (is_register(location(quad->operand1)))
+            {
+                operation("push " + location(quad->operand1));
+            }
+            else
+            {
+                load("r10", quad->operand1);
+                operation("push r10");
+            }
 
             break;
         }
         case Quad::Operation::I_STORE:
         {
-            operation("mov qword [" + address(quad->dest) + "], " +
-                      std::to_string(quad->operand1));
+            std::string dest  = location(quad->dest);
+            std::string value = std::to_string(quad->operand1);
+
+            if (is_register(dest))
+            {
+                operation("mov " + dest + ", " + value);
+            }
+            else if (quad->operand1 == (int)quad->operand1)
+            {
+                operation("mov qword " + dest + ", " + value);
+            }
+            else
+            {
+                // NOTE: Only a register can be given a 64-bit immediate
+                operation("mov r10, " + value);
+                store(quad->dest, "r10");
+            }
 
             break;
         }
         case Quad::Operation::FUNCTION_CALL:
         {
-            FunctionSymbol *function =
+            FunctionSymbol *callee =
                 symbol_table->get_function_symbol(quad->operand1);
 
-            operation("call L" + std::to_string(function->label));
-
-            if (function->parameter_count > 0)
+            if (options.optimization_level >= 2 &&
+                is_tail_call(function_quads, i) &&
+                can_tail_call(function, callee))
             {
-                // NOTE: Before we call this function we have pushed all the
-                // arguments on top of the stack, but after we return we don't
-                // need them anymore and can safely decrease the stack pointer
-                operation("add rsp, " +
-                          std::to_string(function->parameter_count * 8));
+                generate_tail_call_code(function, quad);
+
+                // NOTE: The return after the call is never reached
+                if (i + 1 < function_quads.size() &&
+                    function_quads[i + 1]->operation ==
+                        Quad::Operation::RETURN)
+                {
+                    i++;
+                }
             }
-
-            // NOTE: Only store return value on stack if the function actually
-            // returns a value.
-            if (function->type != symbol_table->type_void)
+            else
             {
-                ASSERT(quad->dest != -1);
-
-                store(quad->dest, "rax");
+                generate_function_call_code(quad);
             }
 
             break;
@@ -232,50 +1112,59 @@ void CodeGenerator::generate_code(Quads &quads)
         }
         case Quad::Operation::I_ADD:
         {
-            load("r8", quad->operand1);
-            load("r9", quad->operand2);
-            operation("add r8, r9");
-            store(quad->dest, "r8");
+            generate_binary_operation_code(quad, "add", true);
 
             break;
         }
         case Quad::Operation::I_MINUS:
         {
-            load("r8", quad->operand1);
-            load("r9", quad->operand2);
-            operation("sub r8, r9");
-            store(quad->dest, "r8");
+            generate_binary_operation_code(quad, "sub", false);
 
             break;
         }
         case Quad::Operation::I_MULTIPLICATION:
         {
-            load("r8", quad->operand1);
-            load("r9", quad->operand2);
-            operation("imul r8, r9");
-            store(quad->dest, "r8");
+            generate_binary_operation_code(quad, "imul", true);
+
+            break;
+        }
+        case Quad::Operation::I_MULTIPLICATION_IMMEDIATE:
+        {
+            generate_multiplication_by_constant(quad);
 
             break;
         }
         case Quad::Operation::I_DIVISION:
         {
-            // TODO: If operand1 is negative, we get floating point exception
-            operation("mov rdx, 0");
+            // NOTE: idiv divides rdx:rax, so the dividend has to be sign
+            // extended into rdx first
             load("rax", quad->operand1);
-            load("rbx", quad->operand2);
-            operation("idiv rbx");
+            operation("cqo");
+
+            std::string divisor = location(quad->operand2);
+            operation("idiv " + (is_register(divisor) ? divisor
+                                                      : "qword " + divisor));
             store(quad->dest, "rax");
 
             break;
         }
+        case Quad::Operation::I_DIVISION_IMMEDIATE:
+        {
+            generate_division_by_constant(quad);
+
+            break;
+        }
         case Quad::Operation::UNARY_MINUS:
         {
             // NOTE: Integers are stored as twos complement, so we invert and
             // add one to make it the negataive version of itself
-            load("rax", quad->operand1);
-            operation("not rax");
-            operation("add rax, 1");
-            store(quad->dest, "rax");
+            std::string dest = location(quad->dest);
+            std::string reg  = is_register(dest) ? dest : "rax";
+
+            load(reg, quad->operand1);
+            operation("not " + reg);
+            operation("add " + reg + ", 1");
+            store(quad->dest, reg);
 
             break;
         }
@@ -322,13 +1211,23 @@ void CodeGenerator::generate_code(Quads &quads)
             ASSERT(quad->operand1 != -1);
             ASSERT(quad->operand2 != -1);
 
-            load("rax", quad->operand1);
-            operation("mov rbx, 1");
-            operation("cmp rax, rbx");
+            std::string condition = location(quad->operand1);
+            operation("cmp " +
+                      (is_register(condition) ? condition
+                                              : "qword " + condition) +
+                      ", 1");
             operation("jne L" + std::to_string(quad->operand2));
 
             break;
         }
+        case Quad::Operation::JUMP:
+        {
+            ASSERT(quad->operand1 != -1);
+
+            operation("jmp L" + std::to_string(quad->operand1));
+
+            break;
+        }
         default:
         {
             report_internal_compiler_error(
@@ -337,18 +1236,19 @@ void CodeGenerator::generate_code(Quads &quads)
         }
 
 #if MA_ASM_COM == 1
-        out << std::endl;
+        text("");
 #endif
-
-        quad = quads.get_current_quad();
     }
 
     // NOTE: We need to generate an implicit return if the function body does
-    // not contain an explicit return statement
-    if (!function->has_return)
+    // not end with an explicit return statement
+    if (function_quads.empty() ||
+        function_quads.back()->operation != Quad::Operation::RETURN)
     {
         generate_function_epilogue(function);
     }
+
+    flush();
 }
 
 void CodeGenerator::generate_function_prologue(FunctionSymbol *function) const
@@ -362,22 +1262,86 @@ void CodeGenerator::generate_function_prologue(FunctionSymbol *function) const
     // ===================================
 
 #if MA_ASM_COM == 1
-    out << "\t;; Prologue" << std::endl;
+    text("\t;; Prologue");
 #endif
 
-    operation("push rbp");     // Push previous frames RBP
-    operation("mov rbp, rsp"); // Set RBP to current frame
+    if (omit_frame)
+    {
+        // NOTE: The callee saved registers go in the red zone as well, below
+        // the variables
+        for (int i = 0; i < allocation.callee_saved.size(); i++)
+        {
+            operation("mov [" + saved_register_address(i) + "], " +
+                      allocation.callee_saved[i]);
+        }
+    }
+    else
+    {
+        operation("push rbp");     // Push previous frames RBP
+        operation("mov rbp, rsp"); // Set RBP to current frame
+
+        // NOTE: Allocate space on the activation record for all variables and
+        // temporary variables used in the function
+        if (frame_size() > 0)
+        {
+            std::string AR_size = std::to_string(frame_size());
+            operation("sub rsp, " + AR_size);
+        }
+
+        // NOTE: Save the callee saved registers we are going to overwrite
+        // below the activation record, so that variable offsets are unaffected
+        for (std::string const &reg : allocation.callee_saved)
+        {
+            operation("push " + reg);
+        }
+    }
+
+    // NOTE: Parameters passed in registers which didn't get a register of
+    // their own are stored in their home slot. The rest are moved to their
+    // allocated register, and stacked parameters are loaded.
+    std::vector<std::pair<std::string, std::string>> moves{};
 
-    // NOTE: Allocate space on the activation record for all variables and
-    // temporary variables used in the function
-    if (function->activation_record_size > 0)
+    int parameter = function->first_parameter;
+    while (options.register_arguments && parameter != -1)
     {
-        std::string AR_size = std::to_string(function->activation_record_size);
-        operation("sub rsp, " + AR_size);
+        ParameterSymbol *symbol = symbol_table->get_parameter_symbol(parameter);
+        int              index  = symbol->index;
+
+        if (index >= ARGUMENT_REGISTERS)
+        {
+            break;
+        }
+
+        if (allocation.registers.count(parameter) == 0)
+        {
+            store_parameter(parameter);
+        }
+        else if (std::count(allocation.live_in_parameters.begin(),
+                            allocation.live_in_parameters.end(),
+                            parameter) == 1)
+        {
+            moves.push_back(
+                {location(parameter), get_argument_register(index)});
+        }
+
+        parameter = symbol->next_parameter;
+    }
+
+    parallel_move(moves);
+
+    for (int parameter : allocation.live_in_parameters)
+    {
+        int index = symbol_table->get_parameter_symbol(parameter)->index;
+
+        if (!options.register_arguments || index >= ARGUMENT_REGISTERS)
+        {
+            operation("mov " + location(parameter) + ", [" +
+                      address(parameter) + "]");
+        }
     }
 
 #if MA_ASM_COM == 1
-    out << std::endl;
+    text("");
 #endif
 }
 
@@ -386,43 +1350,73 @@ void CodeGenerator::generate_function_epilogue(FunctionSymbol *function) const
     ASSERT(function != nullptr);
 
 #if MA_ASM_COM == 1
-    out << "\t;; Epilogue" << std::endl;
+    text("\t;; Epilogue");
 #endif
 
+    generate_frame_teardown(function);
+
+    operation("ret");
+
+#if MA_ASM_COM == 1
+    text("");
+#endif
+}
+
+void CodeGenerator::generate_frame_teardown(FunctionSymbol *function) const
+{
     // TODO: Also check that the function returns no values, otherwise this
     // implementation is not okay.
 
+    if (omit_frame)
+    {
+        for (int i = 0; i < allocation.callee_saved.size(); i++)
+        {
+            operation("mov " + allocation.callee_saved[i] + ", [" +
+                      saved_register_address(i) + "]");
+        }
+
+        return;
+    }
+
+    for (auto it = allocation.callee_saved.rbegin();
+         it != allocation.callee_saved.rend(); it++)
+    {
+        operation("pop " + *it);
+    }
+
     // NOTE: Deallocate all the space we allocated in the prologue
-    if (function->activation_record_size > 0)
+    if (frame_size() > 0)
     {
-        std::string AR_size = std::to_string(function->activation_record_size);
+        std::string AR_size = std::to_string(frame_size());
         operation("add rsp, " + AR_size);
     }
 
     operation("pop rbp"); // Set RBP to previous frame, since we are returning
-    operation("ret");
-
-#if MA_ASM_COM == 1
-    out << std::endl;
-#endif
 }
 
-void CodeGenerator::generate_entry_code() const
+void CodeGenerator::generate_entry_code()
 {
-    out << "section .text" << std::endl;
+    text("section .text");
 
     FunctionSymbol *function =
         symbol_table->get_function_symbol(symbol_table->enclosing_scope());
 
     operation("global _start");
 
-    out << std::endl << "_start:" << std::endl;
+    text("");
+    instructions.push_back(Instruction(Instruction::Kind::Label, "_start"));
 
-    operation("call L" + std::to_string(function->label));
+    entry_label = "L" + std::to_string(function->label);
+    operation("call " + entry_label);
 
     label("_EXIT");
 
+    // NOTE: print only writes to a buffer in the runtime
+    operation("call __flush_output");
+
     operation("mov rax, 0x3c");
     operation("mov rdi, 0x00");
     operation("syscall");
+
+    flush();
 }
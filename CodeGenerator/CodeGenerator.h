@@ -1,43 +1,181 @@
 #pragma once
 
 #include "AST/AST.h"
+#include "Cache/FunctionCache.h"
+#include "CodeGenerator/Emitter.h"
+#include "CodeGenerator/Instruction.h"
+#include "CodeGenerator/Peephole.h"
+#include "Options/Options.h"
 #include "Quads/Quads.h"
+#include "RegisterAllocator/RegisterAllocator.h"
 #include "SymbolTable/Symbol.h"
+#include "ThreadPool/ThreadPool.h"
+#include <map>
+#include <memory>
+#include <set>
 #include <string>
 #include <vector>
 
 class CodeGenerator
 {
   public:
-    CodeGenerator(std::ostream &out, SymbolTable *symbol_table);
+    // NOTE: With a thread pool, the code of each function is generated on
+    // it, and everything is put back together in order in finish(). With a
+    // function cache, the code of each function is stored in it.
+    CodeGenerator(std::ostream &out, SymbolTable *symbol_table,
+                  Options const &options, ThreadPool *thread_pool = nullptr,
+                  FunctionCache *function_cache = nullptr);
 
     void generate_code(Quads &quads);
 
+    // NOTE: Emits the code of a function from the function cache, in place
+    // of generating it
+    void reuse_code(std::string const &code);
+
     void generate_function_prologue(FunctionSymbol *function) const;
     void generate_function_epilogue(FunctionSymbol *function) const;
 
-    void generate_entry_code() const;
+    void generate_entry_code();
+
+    void generate_predefined_functions();
+
+    // NOTE: Called once after the last function has been generated
+    void finish();
+
+    // NOTE: The label of '#global', which runs the whole program
+    std::string get_entry_label() const;
 
-    void generate_predefined_functions() const;
+    // NOTE: The number of instructions that have been generated, after the
+    // peephole optimizer. Functions from the function cache aren't counted.
+    long get_instruction_count() const;
 
     std::string get_argument_register(int) const;
     void        store_parameter(int) const;
 
+    // NOTE: The number of arguments passed in registers, the rest are pushed
+    static constexpr int ARGUMENT_REGISTERS = 6;
+
+    // NOTE: The System V ABI guarantees that the 128 bytes below rsp aren't
+    // touched by signal handlers, so leaf functions may use them freely
+    static constexpr int RED_ZONE_SIZE = 128;
+
   private:
+    // NOTE: A code generator for a single function on the thread pool, with
+    // the same settings as the parent, that writes to a stream of its own
+    CodeGenerator(std::ostream &out, CodeGenerator const &parent);
+
+    void generate_function(int                        function_index,
+                           std::vector<Quad *> const &function_quads);
+
     void operation(std::string const) const;
     void label(std::string const) const;
     void label(FunctionSymbol const *function) const;
+    void text(std::string const line) const;
+    void comment(Quad::Operation operation) const;
+
+    // NOTE: Runs the peephole optimizer over the buffered instructions, and
+    // prints them
+    void flush();
 
     std::string address(int symbol_index) const;
 
+    // NOTE: Either the register the symbol has been allocated to, or its
+    // memory operand in the activation record
+    std::string location(int symbol_index) const;
+    bool        is_register(std::string const &location) const;
+
+    int frame_size() const;
+    int memory_size(FunctionSymbol const      *function,
+                    std::vector<Quad *> const &quads) const;
+
+    // NOTE: Leaf functions whose variables and saved registers all fit in
+    // the red zone don't set up a frame, and address everything relative to
+    // rsp instead
+    bool        can_omit_frame(int function_index) const;
+    std::string saved_register_address(int index) const;
+
+    // NOTE: Moves values into registers as if all moves happened at once,
+    // even if some destination registers are also sources
+    void parallel_move(
+        std::vector<std::pair<std::string, std::string>> moves) const;
+
+    void generate_function_call_code(Quad const *);
+
+    bool can_tail_call(FunctionSymbol const *caller,
+                       FunctionSymbol const *callee) const;
+    void generate_tail_call_code(FunctionSymbol *caller, Quad const *);
+    void generate_frame_teardown(FunctionSymbol *function) const;
+
     // TODO: There should probably be some sort of register type instead of
     // just a string
     void load(std::string reg, int symbol_index) const;
     void store(int symbol_index, std::string reg) const;
 
+    void allocate_registers(FunctionSymbol const *,
+                            std::vector<Quad *> const &);
+
+    void generate_binary_operation_code(Quad const *, std::string const &,
+                                        bool commutative) const;
     void generate_comparison_code(Quad const *, std::string const &) const;
+    void compare_operands(Quad const *) const;
+
+    void generate_multiplication_by_constant(Quad const *) const;
+    void generate_division_by_constant(Quad const *) const;
+
+    bool        is_fusable_comparison(std::vector<Quad *> const &,
+                                      int quad_index) const;
+    std::string inverted_jump(Quad::Operation) const;
 
     std::ostream &out;
+    Emitter       emitter;
+
+    // NOTE: The instructions of the function that is being generated. Mutable
+    // since even the const helpers emit instructions.
+    mutable std::vector<Instruction> instructions{};
+
+    Peephole peephole{};
 
     SymbolTable *symbol_table;
+
+    Options options;
+
+    Allocation allocation{};
+
+    // NOTE: The functions each generated function calls
+    std::map<int, std::set<int>> call_graph{};
+
+    std::string entry_label{""};
+
+    long instruction_count{0};
+
+    // NOTE: Whether the function that is being generated has no frame, and
+    // how many bytes of its activation record are actually used
+    bool omit_frame{false};
+    int  memory_used{0};
+
+    // NOTE: How many times each symbol is used by the quads of the function
+    // that is being generated, counted once before any of them are
+    std::map<long, int> use_counts{};
+
+    // NOTE: Arguments to the next call, when they are passed in registers
+    std::vector<int> pending_arguments{};
+
+    // NOTE: The function that is being generated
+    int function_index{-1};
+
+    // NOTE: A function whose code is being generated on the thread pool, and
+    // what it produced once it is done
+    struct Job
+    {
+        int         function_index{-1};
+        std::string output{""};
+        Peephole    peephole{};
+        long        instruction_count{0};
+    };
+
+    ThreadPool    *thread_pool{nullptr};
+    FunctionCache *function_cache{nullptr};
+
+    // NOTE: In the order the functions were defined in
+    std::vector<std::shared_ptr<Job>> jobs{};
 };
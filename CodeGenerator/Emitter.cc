@@ -0,0 +1,29 @@
+#include "Emitter.h"
+
+Emitter::Emitter(std::ostream &out) : out{out}
+{
+    buffer.reserve(CHUNK_SIZE);
+}
+
+Emitter &Emitter::operator<<(char c)
+{
+    buffer.push_back(c);
+    return *this;
+}
+
+Emitter &Emitter::operator<<(std::string_view text)
+{
+    if (buffer.size() + text.size() > CHUNK_SIZE)
+    {
+        flush();
+    }
+
+    buffer.append(text);
+    return *this;
+}
+
+void Emitter::flush()
+{
+    out.write(buffer.data(), buffer.size());
+    buffer.clear();
+}
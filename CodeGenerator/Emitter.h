@@ -0,0 +1,28 @@
+#pragma once
+
+#include <iostream>
+#include <string>
+#include <string_view>
+
+// NOTE: An append only buffer that the assembler output is written to before
+// it goes to the output stream. Lines end in '\n' instead of std::endl, and
+// the stream only sees a single write per function, or one per CHUNK_SIZE
+// bytes for very large functions.
+class Emitter
+{
+  public:
+    Emitter(std::ostream &out);
+
+    Emitter &operator<<(char c);
+    Emitter &operator<<(std::string_view text);
+
+    // NOTE: Hands everything that has been buffered to the stream
+    void flush();
+
+  private:
+    std::ostream &out;
+
+    std::string buffer{};
+
+    static constexpr std::size_t CHUNK_SIZE = 1 << 16;
+};
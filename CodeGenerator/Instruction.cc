@@ -0,0 +1,70 @@
+#include "Instruction.h"
+#include "Error/Error.h"
+
+Instruction::Instruction(Kind kind, std::string const &text,
+                         std::string const &comment)
+    : kind{kind}
+{
+    switch (kind)
+    {
+    case Kind::Operation:
+    {
+        std::size_t space = text.find(' ');
+        opcode            = text.substr(0, space);
+
+        while (space != std::string::npos)
+        {
+            std::size_t start = text.find_first_not_of(' ', space);
+            std::size_t comma = text.find(',', start);
+
+            operands.push_back(text.substr(start, comma - start));
+
+            space = comma == std::string::npos ? comma : comma + 1;
+        }
+
+        break;
+    }
+    case Kind::Label:
+    {
+        opcode     = text;
+        this->text = comment;
+        break;
+    }
+    case Kind::Text:
+    {
+        this->text = text;
+        break;
+    }
+    }
+}
+
+Emitter &operator<<(Emitter &emitter, Instruction const &instruction)
+{
+    switch (instruction.kind)
+    {
+    case Instruction::Kind::Operation:
+    {
+        emitter << '\t' << instruction.opcode;
+
+        for (int i = 0; i < instruction.operands.size(); i++)
+        {
+            emitter << (i == 0 ? " " : ", ") << instruction.operands[i];
+        }
+
+        return emitter << '\n';
+    }
+    case Instruction::Kind::Label:
+    {
+        emitter << instruction.opcode << ':';
+
+        if (!instruction.text.empty())
+        {
+            emitter << "\t; " << instruction.text;
+        }
+
+        return emitter << '\n';
+    }
+    case Instruction::Kind::Text:
+    default: return emitter << instruction.text << '\n';
+    }
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include "CodeGenerator/Emitter.h"
+#include <iostream>
+#include <string>
+#include <vector>
+
+// NOTE: One line of assembler output. The code generator collects these for a
+// whole function before printing them, so the peephole optimizer gets a chance
+// to clean up the instruction sequence first.
+struct Instruction
+{
+  public:
+    enum class Kind
+    {
+        // NOTE: An instruction like 'mov rax, [rbp-8]'
+        Operation,
+
+        // NOTE: A jump target
+        Label,
+
+        // NOTE: Anything else, like comments, blank lines and directives, is
+        // printed as is and ignored by the peephole optimizer
+        Text,
+    };
+
+    // NOTE: An operation is given in its textual form and split into opcode
+    // and comma separated operands. The comment is only used for labels.
+    Instruction(Kind kind, std::string const &text,
+                std::string const &comment = "");
+
+    Kind kind;
+
+    // NOTE: The mnemonic of an operation, or the name of a label
+    std::string              opcode{""};
+    std::vector<std::string> operands{};
+
+    // NOTE: The whole line for Text, and the comment after a label
+    std::string text{""};
+
+    friend Emitter &operator<<(Emitter &emitter, Instruction const &);
+};
@@ -0,0 +1,870 @@
+#include "Peephole.h"
+#include "Error/Error.h"
+#include <algorithm>
+#include <climits>
+#include <cstdlib>
+#include <map>
+
+namespace
+{
+
+// NOTE: Registers are numbered like in the instruction encoding, and the flags
+// get a bit of their own so that they can be tracked like a register
+enum : int
+{
+    RAX = 0,
+    RCX,
+    RDX,
+    RBX,
+    RSP,
+    RBP,
+    RSI,
+    RDI,
+    R8,
+    R9,
+    R10,
+    R11,
+    R12,
+    R13,
+    R14,
+    R15,
+    FLAGS,
+};
+
+unsigned const ALL = (1u << (FLAGS + 1)) - 1;
+
+unsigned bit(int reg)
+{
+    return 1u << reg;
+}
+
+std::string const NAMES_64[] = {"rax", "rcx", "rdx", "rbx", "rsp", "rbp",
+                                "rsi", "rdi", "r8",  "r9",  "r10", "r11",
+                                "r12", "r13", "r14", "r15"};
+
+std::string const NAMES_32[] = {"eax",  "ecx",  "edx",  "ebx",
+                                "esp",  "ebp",  "esi",  "edi",
+                                "r8d",  "r9d",  "r10d", "r11d",
+                                "r12d", "r13d", "r14d", "r15d"};
+
+std::string const NAMES_8[] = {"al", "cl", "dl", "bl"};
+
+// NOTE: Returns the number of the register an operand names, or -1 if it
+// isn't a register
+int register_index(std::string const &operand)
+{
+    for (int i = 0; i < 16; i++)
+    {
+        if (operand == NAMES_64[i] || operand == NAMES_32[i] ||
+            (i < 4 && operand == NAMES_8[i]))
+        {
+            return i;
+        }
+    }
+
+    return -1;
+}
+
+bool is_register_64(std::string const &operand)
+{
+    return std::find(std::begin(NAMES_64), std::end(NAMES_64), operand) !=
+           std::end(NAMES_64);
+}
+
+bool is_memory(std::string const &operand)
+{
+    return operand.find('[') != std::string::npos;
+}
+
+// NOTE: Memory operands are compared without their size prefix, since
+// 'qword [rbp-8]' and '[rbp-8]' are the same location
+std::string address(std::string const &operand)
+{
+    std::size_t bracket = operand.find('[');
+    return bracket == std::string::npos ? operand : operand.substr(bracket);
+}
+
+bool is_immediate(std::string const &operand, long &value)
+{
+    if (operand.empty())
+    {
+        return false;
+    }
+
+    char const *begin = operand.c_str();
+    char       *end   = nullptr;
+    value             = std::strtol(begin, &end, 0);
+
+    return *end == '\0';
+}
+
+bool fits_in_32_bits(long value)
+{
+    return value >= INT_MIN && value <= INT_MAX;
+}
+
+// NOTE: All registers an operand mentions, either by naming a register or
+// through the address of a memory operand
+unsigned registers(std::string const &operand)
+{
+    int reg = register_index(operand);
+    if (reg != -1)
+    {
+        return bit(reg);
+    }
+
+    unsigned    result = 0;
+    std::size_t start  = operand.find('[');
+
+    while (start != std::string::npos && start < operand.size())
+    {
+        std::size_t end = operand.find_first_of("+-*]", start + 1);
+        std::size_t first = operand.find_first_not_of(' ', start + 1);
+        std::size_t last  = operand.find_last_not_of(' ', end - 1);
+
+        reg = first > last ? -1
+                           : register_index(
+                                 operand.substr(first, last - first + 1));
+
+        if (reg != -1)
+        {
+            result |= bit(reg);
+        }
+
+        start = end == std::string::npos || operand[end] == ']'
+                    ? std::string::npos
+                    : end;
+    }
+
+    return result;
+}
+
+bool mentions(std::string const &operand, int reg)
+{
+    return (registers(operand) & bit(reg)) != 0;
+}
+
+struct Effects
+{
+    unsigned uses{0};
+    unsigned defines{0};
+};
+
+Effects effects(Instruction const &instruction, Options const &options)
+{
+    Effects result{};
+
+    if (instruction.kind != Instruction::Kind::Operation)
+    {
+        return result;
+    }
+
+    std::string const              &opcode   = instruction.opcode;
+    std::vector<std::string> const &operands = instruction.operands;
+
+    auto read = [&](std::string const &operand)
+    {
+        result.uses |= registers(operand);
+    };
+
+    // NOTE: Writing to memory still reads the registers in its address
+    auto write = [&](std::string const &operand)
+    {
+        int reg = register_index(operand);
+        if (reg != -1)
+        {
+            result.defines |= bit(reg);
+        }
+        else
+        {
+            result.uses |= registers(operand);
+        }
+    };
+
+    static std::string const arithmetic[] = {"add", "sub", "and", "or",
+                                             "xor", "shl", "shr", "sar",
+                                             "adc", "sbb", "imul"};
+
+    bool is_arithmetic = std::find(std::begin(arithmetic), std::end(arithmetic),
+                                   opcode) != std::end(arithmetic);
+
+    if ((opcode == "mov" || opcode == "movzx" || opcode == "movsx" ||
+         opcode == "movsxd" || opcode == "lea") &&
+        operands.size() == 2)
+    {
+        write(operands[0]);
+        read(operands[1]);
+    }
+    else if (opcode == "imul" && operands.size() == 3)
+    {
+        write(operands[0]);
+        read(operands[1]);
+        result.defines |= bit(FLAGS);
+    }
+    else if ((opcode == "imul" || opcode == "mul" || opcode == "idiv" ||
+              opcode == "div") &&
+             operands.size() == 1)
+    {
+        read(operands[0]);
+        result.uses |= bit(RAX);
+        result.uses |= opcode == "idiv" || opcode == "div" ? bit(RDX) : 0;
+        result.defines |= bit(RAX) | bit(RDX) | bit(FLAGS);
+    }
+    else if (is_arithmetic && operands.size() == 2)
+    {
+        // NOTE: Xor of a register with itself doesn't depend on its value
+        if (!(opcode == "xor" && operands[0] == operands[1]))
+        {
+            read(operands[0]);
+            read(operands[1]);
+        }
+
+        write(operands[0]);
+        result.uses |= opcode == "adc" || opcode == "sbb" ? bit(FLAGS) : 0;
+        result.defines |= bit(FLAGS);
+    }
+    else if ((opcode == "cmp" || opcode == "test") && operands.size() == 2)
+    {
+        read(operands[0]);
+        read(operands[1]);
+        result.defines |= bit(FLAGS);
+    }
+    else if ((opcode == "neg" || opcode == "inc" || opcode == "dec") &&
+             operands.size() == 1)
+    {
+        read(operands[0]);
+        write(operands[0]);
+        result.defines |= bit(FLAGS);
+    }
+    else if (opcode == "not" && operands.size() == 1)
+    {
+        read(operands[0]);
+        write(operands[0]);
+    }
+    else if (opcode == "cqo")
+    {
+        result.uses |= bit(RAX);
+        result.defines |= bit(RDX);
+    }
+    else if (opcode == "push" && operands.size() == 1)
+    {
+        read(operands[0]);
+        result.uses |= bit(RSP);
+        result.defines |= bit(RSP);
+    }
+    else if (opcode == "pop" && operands.size() == 1)
+    {
+        write(operands[0]);
+        result.uses |= bit(RSP);
+        result.defines |= bit(RSP);
+    }
+    else if (opcode.compare(0, 4, "cmov") == 0 && operands.size() == 2)
+    {
+        read(operands[0]);
+        read(operands[1]);
+        write(operands[0]);
+        result.uses |= bit(FLAGS);
+    }
+    else if (opcode.compare(0, 3, "set") == 0 && operands.size() == 1)
+    {
+        write(operands[0]);
+        result.uses |= bit(FLAGS);
+    }
+    else if (opcode == "call")
+    {
+        // NOTE: The print routines in the runtime take their argument in
+        // rdi. Other functions only take their arguments in the System V
+        // argument registers with --calling-convention=sysv, and on the
+        // stack otherwise. All of them may clobber the registers the callee
+        // doesn't have to preserve.
+        result.uses |= bit(RSP);
+
+        if (options.register_arguments)
+        {
+            result.uses |= bit(RDI) | bit(RSI) | bit(RDX) | bit(RCX) |
+                           bit(R8) | bit(R9);
+        }
+        else if (operands.size() == 1 && operands[0].compare(0, 2, "__") == 0)
+        {
+            result.uses |= bit(RDI);
+        }
+
+        result.defines |= bit(RAX) | bit(RCX) | bit(RDX) | bit(RSI) |
+                          bit(RDI) | bit(R8) | bit(R9) | bit(R10) | bit(R11) |
+                          bit(FLAGS);
+    }
+    else if (opcode == "ret")
+    {
+        result.uses |= bit(RAX) | bit(RBX) | bit(RSP) | bit(RBP) | bit(R12) |
+                       bit(R13) | bit(R14) | bit(R15);
+    }
+    else if (opcode[0] == 'j')
+    {
+        // NOTE: Where control goes is handled when solving for liveness
+        result.uses |= opcode == "jmp" ? 0 : bit(FLAGS);
+    }
+    else
+    {
+        // NOTE: Anything that isn't known, like syscall, could use anything
+        result.uses |= ALL;
+    }
+
+    return result;
+}
+
+} // namespace
+
+Peephole::Peephole(Options const &options) : options{options}
+{
+    rules = {
+        {"self-move", &Peephole::remove_self_move},
+        {"store-then-load", &Peephole::forward_stored_value},
+        {"load-then-store", &Peephole::remove_redundant_store},
+        {"dead-move", &Peephole::remove_dead_move},
+        {"immediate-operand", &Peephole::fold_immediate},
+        {"retarget-result", &Peephole::retarget_result},
+        {"not-add-to-neg", &Peephole::use_neg},
+        {"zero-idiom", &Peephole::zero_with_xor},
+        {"jump-to-next", &Peephole::remove_jump_to_next},
+    };
+}
+
+void Peephole::optimize(std::vector<Instruction> &instructions)
+{
+    // NOTE: Every sweep tries all rules on every instruction, and rules may
+    // enable each other, so keep sweeping until nothing changes. Liveness is
+    // only recomputed in between sweeps. The rules only ever shorten live
+    // ranges, or move them around within the few instructions they looked at,
+    // so the stale information is still safe to use for the rest of a sweep.
+    this->instructions = &instructions;
+
+    int const MAX_SWEEPS = 8;
+
+    for (int sweep = 0; sweep < MAX_SWEEPS; sweep++)
+    {
+        removed.assign(instructions.size(), false);
+        compute_liveness();
+
+        bool changed = false;
+
+        for (int i = 0; i < instructions.size(); i++)
+        {
+            for (Rule &rule : rules)
+            {
+                if (removed[i] ||
+                    instructions[i].kind != Instruction::Kind::Operation)
+                {
+                    break;
+                }
+
+                if ((this->*rule.apply)(i))
+                {
+                    rule.hits++;
+                    changed = true;
+                }
+            }
+        }
+
+        std::vector<Instruction> kept{};
+        for (int i = 0; i < instructions.size(); i++)
+        {
+            if (!removed[i])
+            {
+                kept.push_back(instructions[i]);
+            }
+        }
+
+        instructions.swap(kept);
+
+        if (!changed)
+        {
+            break;
+        }
+    }
+
+    this->instructions = nullptr;
+}
+
+void Peephole::print_report(std::ostream &os) const
+{
+    for (Rule const &rule : rules)
+    {
+        os << "Peephole rule '" << rule.name << "' fired " << rule.hits
+           << " times" << std::endl;
+    }
+}
+
+void Peephole::merge(Peephole const &other)
+{
+    ASSERT(rules.size() == other.rules.size());
+
+    for (int i = 0; i < rules.size(); i++)
+    {
+        rules[i].hits += other.rules[i].hits;
+    }
+}
+
+int Peephole::next(int position) const
+{
+    for (int i = position + 1; i < instructions->size(); i++)
+    {
+        if (!removed[i] && (*instructions)[i].kind != Instruction::Kind::Text)
+        {
+            return i;
+        }
+    }
+
+    return -1;
+}
+
+bool Peephole::is_operation(int position, std::string const &opcode) const
+{
+    return position != -1 &&
+           (*instructions)[position].kind == Instruction::Kind::Operation &&
+           (*instructions)[position].opcode == opcode;
+}
+
+void Peephole::remove(int position)
+{
+    removed[position] = true;
+}
+
+void Peephole::compute_liveness()
+{
+    // NOTE: Standard backwards dataflow over the instructions of the function.
+    // Jumps to labels outside of it, like tail calls, and falling off the end
+    // conservatively keep everything alive.
+    std::vector<Instruction> const &code = *instructions;
+
+    std::map<std::string, int> labels{};
+    for (int i = 0; i < code.size(); i++)
+    {
+        if (code[i].kind == Instruction::Kind::Label)
+        {
+            labels[code[i].opcode] = i;
+        }
+    }
+
+    std::vector<Effects> effect(code.size());
+    std::vector<int>     target(code.size(), -1);
+    std::vector<bool>    falls_through(code.size(), true);
+    std::vector<bool>    escapes(code.size(), false);
+
+    for (int i = 0; i < code.size(); i++)
+    {
+        Instruction const &instruction = code[i];
+        effect[i]                      = effects(instruction, options);
+
+        if (instruction.kind != Instruction::Kind::Operation)
+        {
+            continue;
+        }
+
+        if (instruction.opcode == "ret")
+        {
+            falls_through[i] = false;
+        }
+        else if (instruction.opcode[0] == 'j' &&
+                 instruction.operands.size() == 1)
+        {
+            auto label = labels.find(instruction.operands[0]);
+
+            if (label != labels.end())
+            {
+                target[i] = label->second;
+            }
+            else
+            {
+                escapes[i] = true;
+            }
+
+            falls_through[i] = instruction.opcode != "jmp";
+        }
+    }
+
+    std::vector<unsigned> live_before(code.size(), 0);
+    live_after.assign(code.size(), 0);
+
+    bool changed = true;
+    while (changed)
+    {
+        changed = false;
+
+        for (int i = code.size() - 1; i >= 0; i--)
+        {
+            unsigned out = escapes[i] ? ALL : 0;
+
+            if (falls_through[i])
+            {
+                out |= i + 1 < code.size() ? live_before[i + 1] : ALL;
+            }
+
+            if (target[i] != -1)
+            {
+                out |= live_before[target[i]];
+            }
+
+            unsigned in = effect[i].uses | (out & ~effect[i].defines);
+
+            if (in != live_before[i] || out != live_after[i])
+            {
+                live_before[i] = in;
+                live_after[i]  = out;
+                changed        = true;
+            }
+        }
+    }
+}
+
+bool Peephole::is_live_after(int position, int reg) const
+{
+    // NOTE: The stack and frame pointers are never up for grabs
+    unsigned live = live_after[position] | bit(RSP) | bit(RBP);
+    return (live & bit(reg)) != 0;
+}
+
+bool Peephole::are_flags_live_after(int position) const
+{
+    return (live_after[position] & bit(FLAGS)) != 0;
+}
+
+bool Peephole::remove_self_move(int position)
+{
+    // NOTE: mov rsi, rsi
+    Instruction const &instruction = (*instructions)[position];
+
+    if (instruction.opcode != "mov" ||
+        !is_register_64(instruction.operands[0]) ||
+        instruction.operands[0] != instruction.operands[1])
+    {
+        return false;
+    }
+
+    remove(position);
+    return true;
+}
+
+bool Peephole::forward_stored_value(int position)
+{
+    // NOTE: mov [rbp-8], rsi
+    //       mov rdi, [rbp-8]     =>  mov rdi, rsi
+    Instruction const &store = (*instructions)[position];
+    int                load  = next(position);
+
+    if (store.opcode != "mov" || !is_memory(store.operands[0]) ||
+        !is_register_64(store.operands[1]) || !is_operation(load, "mov"))
+    {
+        return false;
+    }
+
+    Instruction &instruction = (*instructions)[load];
+
+    if (!is_register_64(instruction.operands[0]) ||
+        address(instruction.operands[1]) != address(store.operands[0]))
+    {
+        return false;
+    }
+
+    if (instruction.operands[0] == store.operands[1])
+    {
+        remove(load);
+    }
+    else
+    {
+        instruction.operands[1] = store.operands[1];
+    }
+
+    return true;
+}
+
+bool Peephole::remove_redundant_store(int position)
+{
+    // NOTE: mov rsi, [rbp-8]
+    //       mov [rbp-8], rsi     =>  mov rsi, [rbp-8]
+    Instruction const &load  = (*instructions)[position];
+    int                store = next(position);
+
+    if (load.opcode != "mov" || !is_register_64(load.operands[0]) ||
+        !is_memory(load.operands[1]) || !is_operation(store, "mov"))
+    {
+        return false;
+    }
+
+    Instruction const &instruction = (*instructions)[store];
+    int                reg         = register_index(load.operands[0]);
+
+    if (instruction.operands[1] != load.operands[0] ||
+        address(instruction.operands[0]) != address(load.operands[1]) ||
+        mentions(load.operands[1], reg))
+    {
+        return false;
+    }
+
+    remove(store);
+    return true;
+}
+
+bool Peephole::remove_dead_move(int position)
+{
+    // NOTE: Moves and zeroing of registers that are never read again
+    Instruction const &instruction = (*instructions)[position];
+
+    bool is_move = instruction.opcode == "mov" || instruction.opcode == "lea";
+    bool is_zeroing = instruction.opcode == "xor" &&
+                      instruction.operands[0] == instruction.operands[1] &&
+                      !are_flags_live_after(position);
+
+    if (!is_move && !is_zeroing)
+    {
+        return false;
+    }
+
+    int reg = register_index(instruction.operands[0]);
+
+    if (reg == -1 || is_live_after(position, reg))
+    {
+        return false;
+    }
+
+    remove(position);
+    return true;
+}
+
+bool Peephole::fold_immediate(int position)
+{
+    // NOTE: mov rsi, 3
+    //       cmp rdi, rsi         =>  cmp rdi, 3
+    //
+    // The register has to be dead after it is used, and the use has to follow
+    // within a couple of instructions in the same basic block.
+    Instruction const &instruction = (*instructions)[position];
+    long               value       = 0;
+
+    if (instruction.opcode != "mov" ||
+        !is_register_64(instruction.operands[0]) ||
+        !is_immediate(instruction.operands[1], value) ||
+        !fits_in_32_bits(value))
+    {
+        return false;
+    }
+
+    std::string const &name = instruction.operands[0];
+    int                reg  = register_index(name);
+
+    int const MAX_DISTANCE = 4;
+
+    bool found = false;
+    int  use   = next(position);
+
+    for (int distance = 0; use != -1 && distance < MAX_DISTANCE; distance++)
+    {
+        Instruction const &candidate = (*instructions)[use];
+
+        if (candidate.kind != Instruction::Kind::Operation ||
+            candidate.opcode[0] == 'j' || candidate.opcode == "call" ||
+            candidate.opcode == "ret")
+        {
+            return false;
+        }
+
+        Effects effect = effects(candidate, options);
+        if ((effect.uses | effect.defines) & bit(reg))
+        {
+            found = true;
+            break;
+        }
+
+        use = next(use);
+    }
+
+    if (!found || is_live_after(use, reg))
+    {
+        return false;
+    }
+
+    Instruction &user = (*instructions)[use];
+
+    static std::string const binary[] = {"cmp", "add", "sub",
+                                         "and", "or",  "xor"};
+
+    bool is_binary = std::find(std::begin(binary), std::end(binary),
+                               user.opcode) != std::end(binary);
+
+    if (user.opcode == "push" && user.operands[0] == name)
+    {
+        user.operands[0] = instruction.operands[1];
+    }
+    else if (user.operands.size() != 2 || user.operands[1] != name ||
+             mentions(user.operands[0], reg))
+    {
+        return false;
+    }
+    else if (is_binary || user.opcode == "mov")
+    {
+        // NOTE: Without a register the assembler can't tell the size
+        if (is_memory(user.operands[0]) &&
+            user.operands[0].compare(0, 6, "qword ") != 0)
+        {
+            user.operands[0] = "qword " + user.operands[0];
+        }
+
+        user.operands[1] = instruction.operands[1];
+    }
+    else if (user.opcode == "imul" && is_register_64(user.operands[0]))
+    {
+        user.operands = {user.operands[0], user.operands[0],
+                         instruction.operands[1]};
+    }
+    else
+    {
+        return false;
+    }
+
+    remove(position);
+    return true;
+}
+
+bool Peephole::retarget_result(int position)
+{
+    // NOTE: mov rsi, rdi
+    //       add rsi, r8
+    //       mov r9, rsi          =>  mov r9, rdi
+    //                                add r9, r8
+    //
+    // And the same thing without the operation in the middle. The temporary
+    // register has to be dead afterwards, and the final destination can't be
+    // read by the operation.
+    Instruction &copy = (*instructions)[position];
+
+    if (copy.opcode != "mov" || !is_register_64(copy.operands[0]))
+    {
+        return false;
+    }
+
+    std::string const temporary = copy.operands[0];
+    int               reg       = register_index(temporary);
+
+    static std::string const binary[] = {"add", "sub", "and", "or", "xor",
+                                         "imul", "shl", "shr", "sar"};
+
+    int operation = next(position);
+    int result    = operation;
+
+    if (operation != -1 &&
+        (*instructions)[operation].kind == Instruction::Kind::Operation &&
+        std::find(std::begin(binary), std::end(binary),
+                  (*instructions)[operation].opcode) != std::end(binary) &&
+        (*instructions)[operation].operands.size() == 2 &&
+        (*instructions)[operation].operands[0] == temporary &&
+        !mentions((*instructions)[operation].operands[1], reg))
+    {
+        result = next(operation);
+    }
+    else
+    {
+        operation = -1;
+    }
+
+    if (!is_operation(result, "mov"))
+    {
+        return false;
+    }
+
+    Instruction const &move = (*instructions)[result];
+
+    if (move.operands[1] != temporary || !is_register_64(move.operands[0]) ||
+        move.operands[0] == temporary || is_live_after(result, reg))
+    {
+        return false;
+    }
+
+    std::string const destination = move.operands[0];
+    int               target      = register_index(destination);
+
+    if (operation != -1 &&
+        mentions((*instructions)[operation].operands[1], target))
+    {
+        return false;
+    }
+
+    copy.operands[0] = destination;
+
+    if (operation != -1)
+    {
+        (*instructions)[operation].operands[0] = destination;
+    }
+
+    remove(result);
+    return true;
+}
+
+bool Peephole::use_neg(int position)
+{
+    // NOTE: not rsi
+    //       add rsi, 1           =>  neg rsi
+    Instruction &instruction = (*instructions)[position];
+    int          add         = next(position);
+
+    if (instruction.opcode != "not" || !is_operation(add, "add") ||
+        (*instructions)[add].operands[0] != instruction.operands[0] ||
+        (*instructions)[add].operands[1] != "1" || are_flags_live_after(add))
+    {
+        return false;
+    }
+
+    instruction.opcode = "neg";
+    remove(add);
+    return true;
+}
+
+bool Peephole::zero_with_xor(int position)
+{
+    // NOTE: mov rsi, 0           =>  xor esi, esi
+    //
+    // Writing the 32 bit register clears the upper half too, and the encoding
+    // is shorter, but it clobbers the flags.
+    Instruction &instruction = (*instructions)[position];
+
+    if (instruction.opcode != "mov" ||
+        !is_register_64(instruction.operands[0]) ||
+        instruction.operands[1] != "0" || are_flags_live_after(position))
+    {
+        return false;
+    }
+
+    std::string const &name = NAMES_32[register_index(instruction.operands[0])];
+
+    instruction.opcode   = "xor";
+    instruction.operands = {name, name};
+    return true;
+}
+
+bool Peephole::remove_jump_to_next(int position)
+{
+    // NOTE: jmp L3
+    //   L3:
+    Instruction const &instruction = (*instructions)[position];
+
+    if (instruction.opcode != "jmp")
+    {
+        return false;
+    }
+
+    for (int i = next(position); i != -1; i = next(i))
+    {
+        Instruction const &candidate = (*instructions)[i];
+
+        if (candidate.kind != Instruction::Kind::Label)
+        {
+            return false;
+        }
+
+        if (candidate.opcode == instruction.operands[0])
+        {
+            remove(position);
+            return true;
+        }
+    }
+
+    return false;
+}
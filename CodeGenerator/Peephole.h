@@ -0,0 +1,66 @@
+#pragma once
+
+#include "CodeGenerator/Instruction.h"
+#include "Options/Options.h"
+#include <iostream>
+#include <string>
+#include <vector>
+
+// NOTE: Cleans up the instructions the code generator emits for a function.
+// Short sequences are matched against a table of rules, and replaced with
+// fewer or cheaper instructions.
+class Peephole
+{
+  public:
+    Peephole(Options const &options = {});
+
+    void optimize(std::vector<Instruction> &instructions);
+
+    void print_report(std::ostream &os) const;
+
+    // NOTE: Adds the hits of another peephole optimizer to this one's, for
+    // functions that were optimized on another thread
+    void merge(Peephole const &other);
+
+  private:
+    // NOTE: A rule looks at the instruction at the given position and the
+    // ones right after it, and returns whether it changed anything
+    using Apply = bool (Peephole::*)(int position);
+
+    struct Rule
+    {
+        std::string name;
+        Apply       apply;
+        int         hits{0};
+    };
+
+    bool remove_self_move(int position);
+    bool forward_stored_value(int position);
+    bool remove_redundant_store(int position);
+    bool remove_dead_move(int position);
+    bool fold_immediate(int position);
+    bool retarget_result(int position);
+    bool use_neg(int position);
+    bool zero_with_xor(int position);
+    bool remove_jump_to_next(int position);
+
+    // NOTE: The position of the next instruction or label that hasn't been
+    // removed, or -1 if there is none
+    int  next(int position) const;
+    bool is_operation(int position, std::string const &opcode) const;
+    void remove(int position);
+
+    void compute_liveness();
+    bool is_live_after(int position, int reg) const;
+    bool are_flags_live_after(int position) const;
+
+    std::vector<Rule> rules{};
+
+    Options options;
+
+    // NOTE: The function that is being optimized, which instructions have
+    // been removed from it and which registers are live after each of them
+    std::vector<Instruction> *instructions{nullptr};
+    std::vector<bool>         removed{};
+    std::vector<unsigned>     live_after{};
+};
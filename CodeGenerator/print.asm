@@ -1,120 +1,176 @@
 
 ;; ===== print.asm =====
 
+OUTPUT_BUFFER_SIZE equ 65536
+
+section .data
+	trueText db 'true', 10
+	falseText db 'false', 10
+	digitPairs db '0001020304050607080910111213141516171819'	; '00' to '99'
+		db '2021222324252627282930313233343536373839'
+		db '4041424344454647484950515253545556575859'
+		db '6061626364656667686970717273747576777879'
+		db '8081828384858687888990919293949596979899'
+
 section .bss
-	printArea resb 100			; Where we store our converted string
-	printAreaIndex resb 8		; Points to current index into printArea
+	outputBuffer resb OUTPUT_BUFFER_SIZE	; Output that hasn't been written yet
+	outputBufferIndex resq 1	; Number of bytes used in outputBuffer
 
 section .text
 
+;; NOTE: These routines follow the System V ABI. They take their argument in
+;; rdi, keep their scratch space on the stack and only use registers that the
+;; caller doesn't expect to be preserved.
+
 __print_integer:
-	;; Before calling this function, store the value that you want to
-	;; print in rax
+	;; Prints the value in rdi. Two digits are converted at a time, by
+	;; multiplying with the reciprocal of 100 instead of dividing and looking
+	;; the digits up in digitPairs.
 
-	push rax					; Save rax for later, to see if its negative
+	sub rsp, 32					; Where we store our converted string
 
+	;; The string is built backwards from the end of the scratch space
+	lea rcx, [rsp + 31]			; Load end of the string
+	mov byte [rcx], 10			; Store newline at end of the string
+
+	mov rax, rdi
 	test rax, rax
-	jns _prepare_conversion 	; If not negative
+	jns _conv_pairs_to_chars	; If not negative
 
-	;; Convert negative number to positive
-	not rax
-	add rax, 1
+	;; Convert negative number to positive. The smallest integer stays the
+	;; same, which is still right when it is treated as an unsigned number.
+	neg rax
 
-_prepare_conversion:
-	mov rcx, printArea 			; Load beginning of printArea
+_conv_pairs_to_chars:
+	cmp rax, 100
+	jb _conv_last_chars			; If there are at most two digits left
 
-	mov rbx, 10					; Load newline
-	mov [rcx], rbx				; Store newline at beginning of printArea
+	;; rdx = rax / 100, computed as ((rax / 4) * ceil(2^66 / 100)) / 2^66
+	mov rsi, rax
+	shr rax, 2
+	mov rdx, 0x28f5c28f5c28f5c3
+	mul rdx
+	shr rdx, 2
 
-_conv_digits_to_chars:
-	;; Move to next index
-	inc rcx						; Move to next index
-	mov [printAreaIndex], rcx	; Store new index
+	mov rax, rdx				; The digits that are left
+	imul rdx, rdx, 100
+	sub rsi, rdx				; The last two digits
 
-	;; Perform division, value stored in rax, remainder in rdx
-	mov rdx, 0					; Clear rdx, used implicitly in division
-	mov rbx, 10					; Divide by 10
-	div rbx						; Divide rax by rbx
+	movzx edx, word [digitPairs + rsi*2]
+	sub rcx, 2					; Move to previous index
+	mov [rcx], dx				; Store both chars
 
-	;; Perform conversion and store char
-	add rdx, 48					; Convert the number to a char
-	mov [rcx], dl				; Store char (dl lowest 8 bits from rdx)
+	jmp _conv_pairs_to_chars
 
-	cmp rax, 0					; Do we have any more numbers to convert?
-	jne _conv_digits_to_chars	; If we do, repeat this loop
+_conv_last_chars:
+	cmp rax, 10
+	jb _conv_last_char			; If there is only one digit left
 
-	pop rax
+	movzx edx, word [digitPairs + rax*2]
+	sub rcx, 2					; Move to previous index
+	mov [rcx], dx				; Store both chars
 
-	test rax, rax
+	jmp _add_sign
+
+_conv_last_char:
+	add rax, 48					; Convert the number to a char
+	dec rcx						; Move to previous index
+	mov [rcx], al				; Store char
+
+_add_sign:
+	test rdi, rdi
 	jns _print_chars			; If its not negative, just print chars
 
 	;; If its negative, add a minus sign to the front
-	inc rcx						; Move to next index
-	mov [printAreaIndex], rcx	; Store new index
-
-	mov rbx, 45					; Load hyphen '-'
-	mov [rcx], rbx				; Store hyphen
+	dec rcx						; Move to previous index
+	mov byte [rcx], 45			; Store hyphen '-'
 
 _print_chars:
-	mov  rcx, [printAreaIndex]	; Load character
-
-	;;  Write syscall
-	mov rax, 0x1
-	mov rdi, 0x1
-	mov rsi, rcx
-	mov rdx, 1
-	syscall
+	mov rsi, rcx				; Start of the string
+	lea rdx, [rsp + 32]
+	sub rdx, rcx				; Length of the string
 
-	mov rcx, [printAreaIndex]	; Load character
-	dec rcx						; Move backward one character
-	mov [printAreaIndex], rcx	; Store new position
+	call __write_output
 
-	cmp rcx, printArea			; Are we at beginning of string?
-	jge _print_chars 			; If not, print another character
+	add rsp, 32
 
 	ret
 
 __print_bool:
-	;; Put the values 0 or 1 in rax to print them
+	;; Prints the value 0 or 1 in rdi
 
-	mov rcx, printArea 			; Load beginning of printArea
+	cmp	rdi, 0
+	je _print_false
 
-	cmp	rax, 0
-	je _store_false
+	mov rsi, trueText
+	mov rdx, 5					; We want to print 'true\n', length = 5
 
-_store_true:
+	jmp __write_output
 
-	mov [rcx], dword 'true'
+_print_false:
+	mov rsi, falseText
+	mov rdx, 6					; We want to print 'false\n', length = 6
 
-	add rcx, 4					; Move forward as many bytes as we wrote
-	mov rdx, 5					; We want to print 'true\n', length = 5
+	jmp __write_output
 
-	jmp _print_bool_chars
+__write_output:
+	;; Appends the rdx bytes at rsi to outputBuffer, and writes the buffer
+	;; out first if they don't fit
 
-_store_false:
+	mov rax, [outputBufferIndex]
+	add rax, rdx
+	cmp rax, OUTPUT_BUFFER_SIZE
+	jbe _copy_output			; If they fit
 
-	mov [rcx], dword 'fals'
-	add rcx, 4					; Move forward as many bytes as we wrote
+	push rsi
+	push rdx
+	call __flush_output
+	pop rdx
+	pop rsi
 
-	mov [rcx], byte 'e'
-	add rcx, 1					; Move forward as many bytes as we wrote
+_copy_output:
+	mov rdi, [outputBufferIndex]
+	add [outputBufferIndex], rdx
+	add rdi, outputBuffer		; Where to copy to
 
-	mov rdx, 6					; We want to print 'false\n', length = 6
+_copy_output_char:
+	mov al, [rsi]
+	mov [rdi], al
 
-_print_bool_chars:
+	inc rsi
+	inc rdi
+	dec rdx
+	jnz _copy_output_char		; If there are more chars to copy
 
-	mov rbx, 10					; Load newline
-	mov [rcx], rbx				; Store newline at beginning of printArea
+	ret
 
-	inc rcx
+__flush_output:
+	;; Writes everything in outputBuffer to stdout. Called when the buffer
+	;; is full and once when the program exits. A program that crashes never
+	;; gets here, and loses the output that is still in the buffer.
 
-	;;  Write syscall
+	mov rsi, outputBuffer
+	mov rdx, [outputBufferIndex]
+
+_flush_remaining:
+	cmp rdx, 0
+	jle _flush_done				; If everything has been written
+
+	;;  Write syscall, which may write less than we asked for
 	mov rax, 0x1
 	mov rdi, 0x1
-	mov rsi, printArea
-	;; rdx is set previously, depending on true or false
 	syscall
 
+	cmp rax, 0
+	jle _flush_done				; Give up if writing fails
+
+	add rsi, rax
+	sub rdx, rax
+	jmp _flush_remaining
+
+_flush_done:
+	mov qword [outputBufferIndex], 0
+
 	ret
 
 
@@ -0,0 +1,138 @@
+#include "Compiler.h"
+#include "AST/AST.h"
+#include "Assembler/ElfWriter.h"
+#include "CodeGenerator/CodeGenerator.h"
+#include "Interpreter/BytecodeGenerator.h"
+#include "Interpreter/Interpreter.h"
+#include "Optimizer/Optimizer.h"
+#include "Parser/Parser.h"
+#include "TypeChecker/TypeChecker.h"
+#include <sstream>
+
+Compiler::Compiler(Options const &options, ThreadPool *thread_pool,
+                   Statistics *statistics)
+    : options{options}, thread_pool{thread_pool}, statistics{statistics}
+{
+}
+
+std::string Compiler::compile(std::string const &source,
+                              std::string const &functions)
+{
+    std::istringstream is{source};
+    Tokenizer          tokenizer{is};
+
+    {
+        Statistics::Timer timer{statistics, "tokenize"};
+        tokenizer.tokenize();
+    }
+
+    TypeChecker type_checker{&symbol_table};
+    Quads       quads{&symbol_table};
+    Optimizer   optimizer{&symbol_table, options, statistics};
+
+    // NOTE: The reports are printed while generating code, which reused
+    // functions would be missing from
+    if (options.incremental && !functions.empty() && !options.run &&
+        !options.interpret && !options.spill_report &&
+        !options.peephole_report)
+    {
+        function_cache = std::make_unique<FunctionCache>(
+            functions, &symbol_table, options);
+    }
+
+    std::stringstream os{};
+    CodeGenerator     code_generator{os, &symbol_table, options, thread_pool,
+                                 function_cache.get()};
+
+    BytecodeGenerator bytecode_generator{&bytecode, &symbol_table};
+
+    Parser parser{tokenizer,
+                  &symbol_table,
+                  type_checker,
+                  quads,
+                  optimizer,
+                  code_generator,
+                  options.interpret ? &bytecode_generator : nullptr,
+                  function_cache.get(),
+                  statistics};
+
+    long ast_nodes = AST_Node::get_created_count();
+
+    {
+        Statistics::Timer timer{statistics, "parse"};
+        parser.parse();
+    }
+
+    ast_nodes = AST_Node::get_created_count() - ast_nodes;
+
+    if (function_cache != nullptr)
+    {
+        function_cache->save();
+    }
+
+    if (statistics != nullptr)
+    {
+        statistics->add_count("tokens", tokenizer.get_token_count());
+        statistics->add_count("ast_nodes", ast_nodes);
+        statistics->add_count("symbols", symbol_table.get_symbol_count());
+    }
+
+    entry_label = code_generator.get_entry_label();
+
+    if (options.interpret)
+    {
+        // NOTE: There is nothing to assemble or link
+        return "";
+    }
+
+    if (options.run)
+    {
+        {
+            Statistics::Timer timer{statistics, "assemble"};
+
+            std::stringstream runtime{Jit::get_runtime()};
+            assembler.assemble(runtime);
+            assembler.assemble(os);
+        }
+
+        Statistics::Timer timer{statistics, "link"};
+        jit.load();
+
+        return "";
+    }
+
+    if (options.emit_assembler)
+    {
+        return os.str();
+    }
+
+    {
+        Statistics::Timer timer{statistics, "assemble"};
+        assembler.assemble(os);
+    }
+
+    Statistics::Timer  timer{statistics, "link"};
+    ElfWriter          elf_writer{assembler};
+    std::ostringstream executable{};
+    elf_writer.write(executable);
+
+    return executable.str();
+}
+
+void Compiler::run()
+{
+    if (options.interpret)
+    {
+        Interpreter interpreter{bytecode};
+        interpreter.run();
+    }
+    else if (options.run)
+    {
+        jit.run(entry_label);
+    }
+}
+
+FunctionCache const *Compiler::get_function_cache() const
+{
+    return function_cache.get();
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include "Assembler/Assembler.h"
+#include "Cache/FunctionCache.h"
+#include "Interpreter/Bytecode.h"
+#include "Jit/Jit.h"
+#include "Options/Options.h"
+#include "Statistics/Statistics.h"
+#include "SymbolTable/SymbolTable.h"
+#include "ThreadPool/ThreadPool.h"
+#include <memory>
+#include <string>
+
+// NOTE: Everything from the tokenizer to the ELF writer, which is how madoka,
+// the server and the compile benchmark all compile a program. Each program
+// is compiled by a Compiler of its own.
+class Compiler
+{
+  public:
+    Compiler(Options const &options, ThreadPool *thread_pool = nullptr,
+             Statistics *statistics = nullptr);
+
+    Compiler(Compiler const &)            = delete;
+    Compiler &operator=(Compiler const &) = delete;
+
+    // NOTE: Returns the executable, or the assembler with --emit=asm. With
+    // --run or --interpret nothing is returned, and the program is run by
+    // run() instead. With --incremental, the functions that haven't changed
+    // are reused from the file 'functions'.
+    std::string compile(std::string const &source,
+                        std::string const &functions = "");
+
+    // NOTE: Runs the program that was compiled with --run or --interpret
+    void run();
+
+    // NOTE: nullptr unless the functions were compiled incrementally
+    FunctionCache const *get_function_cache() const;
+
+  private:
+    Options     options;
+    ThreadPool *thread_pool;
+    Statistics *statistics;
+
+    SymbolTable                    symbol_table{};
+    std::unique_ptr<FunctionCache> function_cache{};
+
+    Assembler assembler{};
+    Jit       jit{assembler};
+    Bytecode  bytecode{};
+
+    std::string entry_label{};
+};
@@ -1,13 +1,30 @@
 #include "Error.h"
 
+namespace
+{
+thread_local std::string error_file{};
+
+void print_error_file()
+{
+    if (!error_file.empty())
+    {
+        std::cout << error_file << ": ";
+    }
+}
+} // namespace
+
+void set_error_file(std::string const &file) { error_file = file; }
+
 void report_internal_compiler_error(const std::string message)
 {
+    print_error_file();
     std::cout << "InternalCompilerError: " << message << std::endl;
     std::exit(1);
 }
 
 void report_parse_error(Location const &location, std::string const message)
 {
+    print_error_file();
     std::cout << "ParseError:";
 
     if (location.l1 != -1)
@@ -34,6 +51,14 @@ void report_parse_error_undefined_reference(Token const &token)
 
 void report_type_error(Location const &location, std::string const message)
 {
+    print_error_file();
     std::cout << "TypeError:" << location << ": " << message << std::endl;
     std::exit(1);
 }
+
+void report_runtime_error(std::string const message)
+{
+    print_error_file();
+    std::cout << "RuntimeError: " << message << std::endl;
+    std::exit(1);
+}
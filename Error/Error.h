@@ -17,6 +17,11 @@
 #define ASSERT(condition)
 #endif
 
+// NOTE: Errors are prefixed with the file they are in once this has been
+// called. It only affects the calling thread, so that each file of a batch
+// compile can report its own name.
+void set_error_file(std::string const &file);
+
 void report_internal_compiler_error(std::string const message);
 
 void report_parse_error(Location const &location, std::string const message);
@@ -24,3 +29,5 @@ void report_parse_error_unexpected_token(Token const &token);
 void report_parse_error_undefined_reference(Token const &token);
 
 void report_type_error(Location const &location, std::string const message);
+
+void report_runtime_error(std::string const message);
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// NOTE: A compact form of the optimized quads that the interpreter runs.
+// Every function gets a frame of slots, one for each parameter, variable and
+// temporary it uses, and instructions refer to values by their slot instead of
+// by symbol index. Labels have been resolved to instruction indices.
+struct Bytecode
+{
+    enum class Opcode : std::uint8_t
+    {
+        // NOTE: slot a = constants[b]
+        LOAD_CONSTANT,
+        // NOTE: slot a = slot b
+        MOVE,
+
+        // NOTE: slot a = slot b <op> slot c
+        ADD,
+        SUBTRACT,
+        MULTIPLY,
+        DIVIDE,
+        LESSER_THAN,
+        LESSER_THAN_OR_EQUAL,
+        EQUAL,
+        GREATER_THAN,
+        GREATER_THAN_OR_EQUAL,
+
+        // NOTE: slot a = slot b <op> constants[c]
+        MULTIPLY_CONSTANT,
+        DIVIDE_CONSTANT,
+
+        // NOTE: slot a = -slot b
+        NEGATE,
+
+        // NOTE: Jump to instruction a
+        JUMP,
+        // NOTE: Jump to instruction b unless slot a is 1, like the IF quad
+        JUMP_UNLESS,
+
+        // NOTE: Call function b with the slots in arguments[c] onwards and
+        // store the result in slot a, or throw it away if a is -1
+        CALL,
+        // NOTE: Return slot a, or nothing if a is -1
+        RETURN,
+
+        PRINT_INTEGER,
+        PRINT_BOOL,
+    };
+
+    struct Instruction
+    {
+        Opcode       opcode;
+        std::int32_t a;
+        std::int32_t b;
+        std::int32_t c;
+    };
+
+    struct Function
+    {
+        std::string name;
+
+        int entry{0};
+        int frame_size{0};
+        int parameter_count{0};
+    };
+
+    std::vector<Instruction> code{};
+    std::vector<long>        constants{};
+    std::vector<int>         arguments{};
+    std::vector<Function>    functions{};
+
+    // NOTE: The function the program starts in, i.e. '#global'
+    int entry_function{-1};
+};
@@ -0,0 +1,255 @@
+#include "BytecodeGenerator.h"
+#include "Error/Error.h"
+#include "SymbolTable/Symbol.h"
+
+BytecodeGenerator::BytecodeGenerator(Bytecode    *bytecode,
+                                     SymbolTable *symbol_table)
+    : bytecode{bytecode}, symbol_table{symbol_table}
+{
+    ASSERT(bytecode != nullptr);
+    ASSERT(symbol_table != nullptr);
+}
+
+int BytecodeGenerator::slot(long symbol_index)
+{
+    ASSERT(symbol_index != -1);
+
+    auto it = slots.find(symbol_index);
+    if (it != slots.end())
+    {
+        return it->second;
+    }
+
+    // NOTE: Only the function's own variables have a slot in its frame. The
+    // native code generator can't access the others either, so they get the
+    // same error instead of a slot that starts out as 0.
+    if (symbol_table->get_symbol(symbol_index)->tag == Symbol::Tag::Variable &&
+        !symbol_table->is_local(symbol_index, function_index))
+    {
+        report_internal_compiler_error(
+            "Cannot access variable in enclosing scope");
+    }
+
+    int index = slots.size();
+    slots[symbol_index] = index;
+    return index;
+}
+
+int BytecodeGenerator::constant(long value)
+{
+    bytecode->constants.push_back(value);
+    return bytecode->constants.size() - 1;
+}
+
+void BytecodeGenerator::emit(Bytecode::Opcode opcode, int a, int b, int c)
+{
+    bytecode->code.push_back({opcode, a, b, c});
+}
+
+void BytecodeGenerator::emit_jump(Bytecode::Opcode opcode, int a, long label)
+{
+    jumps.push_back({bytecode->code.size(), label});
+
+    if (opcode == Bytecode::Opcode::JUMP)
+    {
+        emit(opcode, -1);
+    }
+    else
+    {
+        emit(opcode, a, -1);
+    }
+}
+
+void BytecodeGenerator::generate_bytecode(Quads &quads)
+{
+    using Opcode = Bytecode::Opcode;
+
+    function_index = symbol_table->enclosing_scope();
+
+    FunctionSymbol *function =
+        symbol_table->get_function_symbol(function_index);
+
+    slots.clear();
+    labels.clear();
+    jumps.clear();
+    pending_arguments.clear();
+
+    // NOTE: The arguments of a call are copied to the first slots of the
+    // callee's frame, in the same order as the parameters
+    for (int parameter = function->first_parameter; parameter != -1;
+         parameter = symbol_table->get_parameter_symbol(parameter)
+                         ->next_parameter)
+    {
+        slots[parameter] = symbol_table->get_parameter_symbol(parameter)->index;
+    }
+
+    // NOTE: Register the function before generating it so that it can call
+    // itself
+    functions[function_index] = bytecode->functions.size();
+    bytecode->functions.push_back({function->name, (int)bytecode->code.size(),
+                                   0, function->parameter_count});
+
+    // NOTE: '#global' is generated last, so the last function generated is
+    // where the program starts
+    bytecode->entry_function = functions[function_index];
+
+    int print_integer = symbol_table->lookup_symbol(
+        "print#" + std::to_string(symbol_table->type_integer));
+    int print_bool = symbol_table->lookup_symbol(
+        "print#" + std::to_string(symbol_table->type_bool));
+
+    for (Quad *quad = quads.get_current_quad(); quad != nullptr;
+         quad       = quads.get_current_quad())
+    {
+        switch (quad->operation)
+        {
+        case Quad::Operation::I_STORE:
+        {
+            emit(Opcode::LOAD_CONSTANT, slot(quad->dest),
+                 constant(quad->operand1));
+            break;
+        }
+        case Quad::Operation::I_ADD:
+        case Quad::Operation::I_MINUS:
+        case Quad::Operation::I_MULTIPLICATION:
+        case Quad::Operation::I_DIVISION:
+        case Quad::Operation::LESSER_THAN:
+        case Quad::Operation::LESSER_THAN_OR_EQUAL:
+        case Quad::Operation::EQUAL:
+        case Quad::Operation::GREATER_THAN:
+        case Quad::Operation::GREATER_THAN_OR_EQUAL:
+        {
+            Opcode opcode{};
+
+            switch (quad->operation)
+            {
+            case Quad::Operation::I_ADD: opcode = Opcode::ADD; break;
+            case Quad::Operation::I_MINUS: opcode = Opcode::SUBTRACT; break;
+            case Quad::Operation::I_MULTIPLICATION:
+                opcode = Opcode::MULTIPLY;
+                break;
+            case Quad::Operation::I_DIVISION: opcode = Opcode::DIVIDE; break;
+            case Quad::Operation::LESSER_THAN:
+                opcode = Opcode::LESSER_THAN;
+                break;
+            case Quad::Operation::LESSER_THAN_OR_EQUAL:
+                opcode = Opcode::LESSER_THAN_OR_EQUAL;
+                break;
+            case Quad::Operation::EQUAL: opcode = Opcode::EQUAL; break;
+            case Quad::Operation::GREATER_THAN:
+                opcode = Opcode::GREATER_THAN;
+                break;
+            default: opcode = Opcode::GREATER_THAN_OR_EQUAL; break;
+            }
+
+            emit(opcode, slot(quad->dest), slot(quad->operand1),
+                 slot(quad->operand2));
+            break;
+        }
+        case Quad::Operation::I_MULTIPLICATION_IMMEDIATE:
+        {
+            emit(Opcode::MULTIPLY_CONSTANT, slot(quad->dest),
+                 slot(quad->operand1), constant(quad->operand2));
+            break;
+        }
+        case Quad::Operation::I_DIVISION_IMMEDIATE:
+        {
+            emit(Opcode::DIVIDE_CONSTANT, slot(quad->dest),
+                 slot(quad->operand1), constant(quad->operand2));
+            break;
+        }
+        case Quad::Operation::ASSIGN:
+        {
+            emit(Opcode::MOVE, slot(quad->dest), slot(quad->operand1));
+            break;
+        }
+        case Quad::Operation::UNARY_MINUS:
+        {
+            emit(Opcode::NEGATE, slot(quad->dest), slot(quad->operand1));
+            break;
+        }
+        case Quad::Operation::ARGUMENT:
+        {
+            pending_arguments.push_back(slot(quad->operand1));
+            break;
+        }
+        case Quad::Operation::FUNCTION_CALL:
+        {
+            if (quad->operand1 == print_integer || quad->operand1 == print_bool)
+            {
+                ASSERT(pending_arguments.size() == 1);
+
+                emit(quad->operand1 == print_integer ? Opcode::PRINT_INTEGER
+                                                     : Opcode::PRINT_BOOL,
+                     pending_arguments[0]);
+            }
+            else
+            {
+                auto callee = functions.find(quad->operand1);
+                ASSERT(callee != functions.end());
+
+                emit(Opcode::CALL, quad->dest == -1 ? -1 : slot(quad->dest),
+                     callee->second, bytecode->arguments.size());
+
+                bytecode->arguments.insert(bytecode->arguments.end(),
+                                           pending_arguments.begin(),
+                                           pending_arguments.end());
+            }
+
+            pending_arguments.clear();
+            break;
+        }
+        case Quad::Operation::LABEL:
+        {
+            labels[quad->operand1] = bytecode->code.size();
+            break;
+        }
+        case Quad::Operation::IF:
+        {
+            emit_jump(Opcode::JUMP_UNLESS, slot(quad->operand1),
+                      quad->operand2);
+            break;
+        }
+        case Quad::Operation::JUMP:
+        {
+            emit_jump(Opcode::JUMP, -1, quad->operand1);
+            break;
+        }
+        case Quad::Operation::RETURN:
+        {
+            emit(Opcode::RETURN,
+                 quad->operand1 == -1 ? -1 : slot(quad->operand1));
+            break;
+        }
+        default:
+        {
+            report_internal_compiler_error(
+                "BytecodeGenerator: Unknown quad operation");
+        }
+        }
+    }
+
+    // NOTE: Functions without a return statement just fall off the end
+    emit(Opcode::RETURN, -1);
+
+    for (auto [instruction, label] : jumps)
+    {
+        auto target = labels.find(label);
+        ASSERT(target != labels.end());
+
+        Bytecode::Instruction &jump = bytecode->code[instruction];
+
+        if (jump.opcode == Opcode::JUMP)
+        {
+            jump.a = target->second;
+        }
+        else
+        {
+            jump.b = target->second;
+        }
+    }
+
+    // NOTE: Every parameter has a slot even if it is never used, since the
+    // caller always copies all arguments
+    bytecode->functions[functions[function_index]].frame_size = slots.size();
+}
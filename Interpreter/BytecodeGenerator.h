@@ -0,0 +1,39 @@
+#pragma once
+
+#include "Interpreter/Bytecode.h"
+#include "Quads/Quads.h"
+#include "SymbolTable/SymbolTable.h"
+#include <map>
+
+// NOTE: Lowers the quads of each function to bytecode as it is compiled, in
+// place of the code generator
+class BytecodeGenerator
+{
+  public:
+    BytecodeGenerator(Bytecode *bytecode, SymbolTable *symbol_table);
+
+    void generate_bytecode(Quads &quads);
+
+  private:
+    int slot(long symbol_index);
+    int constant(long value);
+
+    void emit(Bytecode::Opcode opcode, int a = -1, int b = -1, int c = -1);
+
+    // NOTE: Jumps to labels that haven't been seen yet are patched once the
+    // whole function has been generated
+    void emit_jump(Bytecode::Opcode opcode, int a, long label);
+
+    Bytecode    *bytecode;
+    SymbolTable *symbol_table;
+
+    // NOTE: From function symbol index to its index in the bytecode
+    std::map<int, int> functions{};
+
+    // NOTE: These are reset for every function
+    int                               function_index{-1};
+    std::map<long, int>               slots{};
+    std::map<long, int>               labels{};
+    std::vector<std::pair<int, long>> jumps{};
+    std::vector<int>                  pending_arguments{};
+};
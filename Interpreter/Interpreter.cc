@@ -0,0 +1,220 @@
+#include "Interpreter.h"
+#include "Error/Error.h"
+#include <algorithm>
+#include <climits>
+#include <iostream>
+
+Interpreter::Interpreter(Bytecode const &bytecode)
+    : bytecode{bytecode}, stack(STACK_SIZE), frames(MAX_CALL_DEPTH)
+{
+}
+
+void Interpreter::run()
+{
+    using Opcode = Bytecode::Opcode;
+
+    ASSERT(bytecode.entry_function != -1);
+
+    // NOTE: Indexed by opcode, so this has to be in the same order as
+    // Bytecode::Opcode
+    static void *const dispatch_table[] = {
+        &&LOAD_CONSTANT,
+        &&MOVE,
+        &&ADD,
+        &&SUBTRACT,
+        &&MULTIPLY,
+        &&DIVIDE,
+        &&LESSER_THAN,
+        &&LESSER_THAN_OR_EQUAL,
+        &&EQUAL,
+        &&GREATER_THAN,
+        &&GREATER_THAN_OR_EQUAL,
+        &&MULTIPLY_CONSTANT,
+        &&DIVIDE_CONSTANT,
+        &&NEGATE,
+        &&JUMP,
+        &&JUMP_UNLESS,
+        &&CALL,
+        &&RETURN,
+        &&PRINT_INTEGER,
+        &&PRINT_BOOL,
+    };
+
+    static_assert(sizeof(dispatch_table) / sizeof(dispatch_table[0]) ==
+                      (int)Opcode::PRINT_BOOL + 1,
+                  "Every opcode needs an entry in the dispatch table");
+
+    Bytecode::Instruction const *code      = bytecode.code.data();
+    long const                  *constants = bytecode.constants.data();
+    int const                   *arguments = bytecode.arguments.data();
+
+    Bytecode::Function const &entry =
+        bytecode.functions[bytecode.entry_function];
+
+    Bytecode::Instruction const *pc         = code + entry.entry;
+    long                        *slots      = stack.data();
+    int                          frame_size = entry.frame_size;
+    std::size_t                  depth      = 0;
+
+    long *stack_end = stack.data() + stack.size();
+
+    std::fill(slots, slots + frame_size, 0);
+
+    // NOTE: Arithmetic is done on unsigned values so that it wraps around on
+    // overflow like the hardware does
+#define DISPATCH() goto *dispatch_table[(int)pc->opcode]
+#define NEXT()                                                                 \
+    pc++;                                                                      \
+    DISPATCH()
+#define BINARY(expression)                                                     \
+    {                                                                          \
+        unsigned long b = slots[pc->b];                                        \
+        unsigned long c = slots[pc->c];                                        \
+        slots[pc->a]    = expression;                                          \
+        NEXT();                                                                \
+    }
+#define RELATION(op)                                                           \
+    {                                                                          \
+        slots[pc->a] = slots[pc->b] op slots[pc->c];                           \
+        NEXT();                                                                \
+    }
+#define DIVISION(divisor)                                                      \
+    {                                                                          \
+        long b = slots[pc->b];                                                 \
+        long c = divisor;                                                      \
+        if (c == 0)                                                            \
+        {                                                                      \
+            error("Division by zero");                                         \
+        }                                                                      \
+        if (b == LONG_MIN && c == -1)                                          \
+        {                                                                      \
+            error("Division overflow");                                        \
+        }                                                                      \
+        slots[pc->a] = b / c;                                                  \
+        NEXT();                                                                \
+    }
+
+    DISPATCH();
+
+LOAD_CONSTANT:
+    slots[pc->a] = constants[pc->b];
+    NEXT();
+
+MOVE:
+    slots[pc->a] = slots[pc->b];
+    NEXT();
+
+ADD:
+    BINARY(b + c);
+SUBTRACT:
+    BINARY(b - c);
+MULTIPLY:
+    BINARY(b * c);
+DIVIDE:
+    DIVISION(slots[pc->c]);
+
+LESSER_THAN:
+    RELATION(<);
+LESSER_THAN_OR_EQUAL:
+    RELATION(<=);
+EQUAL:
+    RELATION(==);
+GREATER_THAN:
+    RELATION(>);
+GREATER_THAN_OR_EQUAL:
+    RELATION(>=);
+
+MULTIPLY_CONSTANT:
+    slots[pc->a] = (unsigned long)slots[pc->b] * constants[pc->c];
+    NEXT();
+DIVIDE_CONSTANT:
+    DIVISION(constants[pc->c]);
+
+NEGATE:
+    slots[pc->a] = -(unsigned long)slots[pc->b];
+    NEXT();
+
+JUMP:
+    pc = code + pc->a;
+    DISPATCH();
+
+JUMP_UNLESS:
+    if (slots[pc->a] != 1)
+    {
+        pc = code + pc->b;
+        DISPATCH();
+    }
+    NEXT();
+
+CALL:
+{
+    Bytecode::Function const &callee = bytecode.functions[pc->b];
+
+    long *callee_slots = slots + frame_size;
+
+    if (depth == frames.size() || callee_slots + callee.frame_size > stack_end)
+    {
+        error("Stack overflow in '" + callee.name + "'");
+    }
+
+    for (int i = 0; i < callee.parameter_count; i++)
+    {
+        callee_slots[i] = slots[arguments[pc->c + i]];
+    }
+
+    std::fill(callee_slots + callee.parameter_count,
+              callee_slots + callee.frame_size, 0);
+
+    frames[depth++] = {pc + 1, slots, frame_size, pc->a};
+
+    slots      = callee_slots;
+    frame_size = callee.frame_size;
+    pc         = code + callee.entry;
+    DISPATCH();
+}
+
+RETURN:
+{
+    long result = pc->a == -1 ? 0 : slots[pc->a];
+
+    if (depth == 0)
+    {
+        output.flush();
+        return;
+    }
+
+    Frame const &frame = frames[--depth];
+
+    pc         = frame.return_address;
+    slots      = frame.slots;
+    frame_size = frame.frame_size;
+
+    if (frame.result != -1)
+    {
+        slots[frame.result] = result;
+    }
+
+    DISPATCH();
+}
+
+PRINT_INTEGER:
+    output.print_integer(slots[pc->a]);
+    NEXT();
+
+PRINT_BOOL:
+    output.print_bool(slots[pc->a]);
+    NEXT();
+
+#undef DISPATCH
+#undef NEXT
+#undef BINARY
+#undef RELATION
+#undef DIVISION
+}
+
+void Interpreter::error(std::string const &message)
+{
+    output.flush();
+    report_runtime_error(message);
+    std::exit(1);
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include "Interpreter/Bytecode.h"
+#include "Output/Output.h"
+#include <string>
+#include <vector>
+
+// NOTE: Runs bytecode directly, without any machine code or files being
+// produced. Every call gets a frame of slots on a stack that is allocated up
+// front, and a call that doesn't fit is an error instead of a crash.
+class Interpreter
+{
+  public:
+    Interpreter(Bytecode const &bytecode);
+
+    void run();
+
+  private:
+    struct Frame
+    {
+        Bytecode::Instruction const *return_address;
+        long                        *slots;
+        int                          frame_size;
+        int                          result;
+    };
+
+    [[noreturn]] void error(std::string const &message);
+
+    Bytecode const &bytecode;
+
+    std::vector<long>  stack;
+    std::vector<Frame> frames;
+
+    Output output{};
+
+    // NOTE: In slots, so the stack takes 32 MiB
+    static constexpr std::size_t STACK_SIZE     = 1 << 22;
+    static constexpr std::size_t MAX_CALL_DEPTH = 1 << 20;
+};
@@ -0,0 +1,109 @@
+#include "Jit.h"
+#include "Error/Error.h"
+#include "Output/Output.h"
+#include <algorithm>
+#include <iostream>
+#include <sys/mman.h>
+
+namespace
+{
+
+std::size_t const PAGE_SIZE = 0x1000;
+
+// NOTE: The program calls these instead of the routines in print.asm
+Output output{};
+
+void print_integer(long value) { output.print_integer(value); }
+void print_bool(long value) { output.print_bool(value); }
+void flush_output(long) { output.flush(); }
+
+std::size_t align(std::size_t value, std::size_t alignment)
+{
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+// NOTE: The runtime routines take their argument in rdi like a C++ function
+// does, but may be called with any stack alignment, so they need a small
+// adapter that aligns the stack
+std::string adapter(std::string const &name, void (*function)(long))
+{
+    return name + ":\n"
+                  "\tpush rbp\n"
+                  "\tmov rbp, rsp\n"
+                  "\tand rsp, -16\n"
+                  "\tmov rax, " +
+           std::to_string((std::uintptr_t)function) +
+           "\n"
+           "\tcall rax\n"
+           "\tmov rsp, rbp\n"
+           "\tpop rbp\n"
+           "\tret\n";
+}
+
+} // namespace
+
+Jit::Jit(Assembler &assembler) : assembler{assembler} {}
+
+Jit::~Jit()
+{
+    if (memory != nullptr)
+    {
+        munmap(memory, memory_size);
+    }
+}
+
+std::string Jit::get_runtime()
+{
+    return "section .text\n" + adapter("__print_integer", print_integer) +
+           adapter("__print_bool", print_bool) +
+           adapter("__flush_output", flush_output);
+}
+
+void Jit::load()
+{
+    std::vector<std::uint8_t> const &text = assembler.get_text();
+    std::vector<std::uint8_t> const &data = assembler.get_data();
+
+    std::size_t data_offset = align(text.size(), PAGE_SIZE);
+    std::size_t bss_offset  = align(data_offset + data.size(), 16);
+
+    memory_size = align(bss_offset + assembler.get_bss_size(), PAGE_SIZE);
+
+    // NOTE: The code refers to labels with 32 bit absolute addresses, just
+    // like in the executable, so it has to be placed in the low 2 GiB
+    void *address = mmap(nullptr, memory_size, PROT_READ | PROT_WRITE,
+                         MAP_PRIVATE | MAP_ANONYMOUS | MAP_32BIT, -1, 0);
+
+    if (address == MAP_FAILED)
+    {
+        report_internal_compiler_error("Could not allocate memory to run in");
+    }
+
+    memory = (std::uint8_t *)address;
+
+    std::uintptr_t base = (std::uintptr_t)memory;
+    assembler.link(base, base + data_offset, base + bss_offset);
+
+    std::copy(text.begin(), text.end(), memory);
+    std::copy(data.begin(), data.end(), memory + data_offset);
+
+    // NOTE: mmap has already zeroed .bss
+    if (data_offset > 0 &&
+        mprotect(memory, data_offset, PROT_READ | PROT_EXEC) != 0)
+    {
+        report_internal_compiler_error("Could not make the code executable");
+    }
+}
+
+void Jit::run(std::string const &entry_label)
+{
+    ASSERT(memory != nullptr);
+
+    void (*entry)() = (void (*)())assembler.get_address(entry_label);
+
+    std::cout.flush();
+
+    entry();
+
+    output.flush();
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include "Assembler/Assembler.h"
+#include <cstdint>
+#include <string>
+
+// NOTE: Runs a compiled program inside of the compiler. The assembled code is
+// placed in executable memory and called like a normal function, and print
+// is implemented by functions in the compiler that write to a buffer, so no
+// files are written and no processes are started.
+class Jit
+{
+  public:
+    Jit(Assembler &assembler);
+    ~Jit();
+
+    // NOTE: Replaces print.asm. Has to be assembled before the program.
+    static std::string get_runtime();
+
+    // NOTE: Maps the assembled program into memory and links it there
+    void load();
+
+    void run(std::string const &entry_label);
+
+  private:
+    Assembler &assembler;
+
+    std::uint8_t *memory{nullptr};
+    std::size_t   memory_size{0};
+};
@@ -1,87 +1,368 @@
-#include "AST/AST.h"
-#include "CodeGenerator/CodeGenerator.h"
-#include "Parser/Parser.h"
-#include "TypeChecker/TypeChecker.h"
+#include "Assembler/ElfWriter.h"
+#include "Cache/Cache.h"
+#include "Compiler/Compiler.h"
+#include "Error/Error.h"
+#include "Options/Options.h"
+#include "Server/Client.h"
+#include "Server/Server.h"
+#include "Statistics/Statistics.h"
+#include "ThreadPool/ThreadPool.h"
+#include <algorithm>
 #include <chrono>
+#include <filesystem>
 #include <fstream>
 #include <iomanip>
+#include <memory>
+#include <set>
+#include <sstream>
 #include <string>
+#include <thread>
+#include <vector>
 
 using namespace std::chrono;
 
-int main(int argc, char **argv)
+namespace
+{
+
+// NOTE: Compiles a single file into the executable 'output', or runs it right
+// away with --run or --interpret
+void compile(std::string const &input, std::string const &output,
+             Options const &options, ThreadPool *thread_pool, Cache *cache)
 {
-    if (argc < 2)
+    auto t1 = high_resolution_clock::now();
+
+    std::ifstream     file{input, std::ifstream::binary};
+    std::stringstream is{};
+    is << file.rdbuf();
+
+    std::string key = cache ? Cache::get_key(is.str(), options) : "";
+
+    if (!key.empty() && cache->fetch(key, output))
     {
-        std::cout << "Please provide an input file" << std::endl;
-        std::exit(0);
+        if (!options.quiet)
+        {
+            duration<float> d = high_resolution_clock::now() - t1;
+            std::cout << "Compiled in: " << std::setprecision(4) << std::fixed
+                      << d.count() << " seconds (cached)" << std::endl;
+        }
+
+        return;
     }
 
-    bool quiet = false;
-    for (int i = 2; i < argc; i++)
+    // NOTE: The statistics are only printed with --stats, but the times of
+    // the phases are printed without --quiet as well
+    Statistics statistics{};
+
+    Compiler compiler{options, thread_pool, &statistics};
+
+    std::string executable = compiler.compile(is.str(), output + ".functions");
+
+    if (options.run || options.interpret)
+    {
+        // NOTE: There is nothing to write
+    }
+    else if (options.emit_assembler)
     {
-        if (argv[i] == std::string("--quiet"))
+        std::ofstream{output + ".asm"} << executable;
+
+        int status_code{0};
         {
-            quiet = true;
+            Statistics::Timer timer{&statistics, "assemble"};
+            status_code = std::system(("nasm -f elf64 -o '" + output +
+                                       ".o' '" + output + ".asm'")
+                                          .c_str());
+        }
+
+        if (status_code != 0)
+        {
+            std::exit(status_code);
+        }
+
+        Statistics::Timer timer{&statistics, "link"};
+        status_code =
+            std::system(("ld -o '" + output + "' '" + output + ".o'").c_str());
+
+        if (status_code != 0)
+        {
+            std::exit(status_code);
         }
     }
+    else
+    {
+        {
+            Statistics::Timer timer{&statistics, "link"};
+            ElfWriter::write(output, executable);
+        }
 
-    auto t1 = high_resolution_clock::now();
+        if (!key.empty())
+        {
+            cache->store(key, output);
+        }
+    }
+
+    auto t2 = high_resolution_clock::now();
+
+    if (options.statistics)
+    {
+        statistics.count_peak_memory();
 
-    std::ifstream is{argv[1], std::ifstream::binary};
+        // NOTE: Printed all at once, since files that are compiled at the
+        // same time share the output
+        std::stringstream ss{};
+        if (options.statistics_json)
+        {
+            statistics.print_json(ss, input);
+        }
+        else
+        {
+            statistics.print(ss, input);
+        }
+        std::cout << ss.str() << std::flush;
+    }
 
-    Tokenizer tokenizer{is};
+    if (!options.quiet)
+    {
+        duration<float> d1 = t2 - t1;
+        std::cout << "Compiled in: " << std::setprecision(4) << std::fixed
+                  << d1.count() << " seconds" << std::endl;
 
-    tokenizer.tokenize();
+        double assembled = statistics.get_time("assemble");
+        double linked    = statistics.get_time("link");
 
-    SymbolTable symbol_table{};
-    TypeChecker type_checker{&symbol_table};
-    Quads       quads{&symbol_table};
+        std::cout << "\tGenerated assembler in: " << std::setprecision(4)
+                  << std::fixed << d1.count() - assembled - linked
+                  << " seconds" << std::endl;
 
-    std::ofstream os{"out.asm"};
-    CodeGenerator code_generator{os, &symbol_table};
+        FunctionCache const *function_cache = compiler.get_function_cache();
+        if (function_cache != nullptr)
+        {
+            std::cout << "\t\tReused " << function_cache->get_reused_count()
+                      << " functions, generated "
+                      << function_cache->get_generated_count() << std::endl;
+        }
 
-    Parser parser{tokenizer, &symbol_table, type_checker, quads,
-                  code_generator};
+        std::cout << "\tAssembled assembler in: " << std::setprecision(4)
+                  << std::fixed << assembled << " seconds" << std::endl;
 
-    parser.parse();
+        std::cout << "\tLinked object file in:  " << std::setprecision(4)
+                  << std::fixed << linked << " seconds" << std::endl;
+    }
 
-    auto t2 = high_resolution_clock::now();
+    compiler.run();
+}
 
-    int status_code = std::system("nasm -f elf64 -o out.o out.asm");
+// NOTE: Compiles every input into an executable of the same name in
+// 'directory', several at a time. Each compile has its own symbol table and
+// everything else, so the only thing they share is the thread pool.
+void compile_batch(std::vector<std::string> const &inputs,
+                   std::string const &directory, Options options, Cache *cache)
+{
+    if (options.run || options.interpret)
+    {
+        std::cout << "Can only run one file at a time" << std::endl;
+        std::exit(1);
+    }
+
+    bool quiet    = options.quiet;
+    options.quiet = true;
 
-    if (status_code != 0)
+    int thread_count = options.jobs;
+    if (thread_count == 0)
     {
-        std::exit(status_code);
+        thread_count = std::thread::hardware_concurrency();
     }
 
-    auto t3 = high_resolution_clock::now();
+    std::filesystem::create_directories(directory);
 
-    status_code = std::system("ld -o out out.o");
+    std::set<std::string> outputs{};
+    for (std::string const &input : inputs)
+    {
+        std::string output =
+            (std::filesystem::path{directory} /
+             std::filesystem::path{input}.stem())
+                .string();
 
-    if (status_code != 0)
+        if (!outputs.insert(output).second)
+        {
+            std::cout << "More than one input would be compiled to '"
+                      << output << "'" << std::endl;
+            std::exit(1);
+        }
+    }
+
+    auto t1 = high_resolution_clock::now();
+
+    // NOTE: The functions of each file are generated on the thread the file
+    // is compiled on. Waiting for the pool from inside one of its tasks
+    // would never finish.
+    ThreadPool thread_pool{std::max(1, thread_count)};
+
+    for (std::string const &input : inputs)
     {
-        std::exit(status_code);
+        std::string output = (std::filesystem::path{directory} /
+                              std::filesystem::path{input}.stem())
+                                 .string();
+
+        thread_pool.submit(
+            [input, output, &options, cache]
+            {
+                set_error_file(input);
+                compile(input, output, options, nullptr, cache);
+            });
     }
 
-    auto t4 = high_resolution_clock::now();
+    thread_pool.wait();
+
+    auto t2 = high_resolution_clock::now();
 
     if (!quiet)
     {
-        duration<float> d1 = t4 - t1;
-        std::cout << "Compiled in: " << std::setprecision(4) << std::fixed
-                  << d1.count() << " seconds" << std::endl;
+        duration<float> d = t2 - t1;
+        std::cout << "Compiled " << inputs.size() << " programs in "
+                  << std::setprecision(4) << std::fixed << d.count()
+                  << " seconds on " << thread_pool.get_thread_count()
+                  << " threads (" << std::setprecision(1)
+                  << inputs.size() / d.count() << " programs per second)"
+                  << std::endl;
+    }
+}
 
-        duration<float> d2 = t2 - t1;
-        std::cout << "\tGenerated assembler in: " << std::setprecision(4)
-                  << std::fixed << d2.count() << " seconds" << std::endl;
+} // namespace
 
-        duration<float> d3 = t3 - t2;
-        std::cout << "\tAssembled assembler in: " << std::setprecision(4)
-                  << std::fixed << d3.count() << " seconds" << std::endl;
+int main(int argc, char **argv)
+{
+    // NOTE: The input files are the arguments that aren't options, so that
+    // both 'madoka file.mdk -O2' and 'madoka --run file.mdk' work
+    std::vector<std::string> inputs{};
 
-        duration<float> d4 = t4 - t3;
-        std::cout << "\tLinked object file in:  " << std::setprecision(4)
-                  << std::fixed << d4.count() << " seconds" << std::endl;
+    // NOTE: -o DIR compiles every input into DIR
+    std::string directory{""};
+
+    // NOTE: --server PATH serves compile requests on the socket PATH, and
+    // --client PATH sends the input to that server instead of compiling it
+    std::string server{""};
+    std::string client{""};
+
+    // NOTE: The options, which the client passes on to the server
+    std::vector<std::string> arguments{};
+
+    Options options{};
+    for (int i = 1; i < argc; i++)
+    {
+        std::string argument{argv[i]};
+
+        if (argument[0] != '-')
+        {
+            inputs.push_back(argument);
+        }
+        else if (argument == "-o" && i + 1 < argc)
+        {
+            directory = argv[++i];
+        }
+        else if (argument == "--server" && i + 1 < argc)
+        {
+            server = argv[++i];
+        }
+        else if (argument == "--client" && i + 1 < argc)
+        {
+            client = argv[++i];
+        }
+        else
+        {
+            parse_option(options, argument);
+            arguments.push_back(argument);
+        }
+    }
+
+    if (!server.empty())
+    {
+        Server{server, options}.run();
+    }
+
+    if (inputs.size() > 1 && directory.empty())
+    {
+        std::cout << "Use -o DIR to compile more than one file" << std::endl;
+        std::exit(1);
+    }
+
+    if (!client.empty() && !inputs.empty())
+    {
+        auto t1 = high_resolution_clock::now();
+
+        int status_code =
+            compile_on_server(client, inputs[0], "out", arguments);
+
+        auto t2 = high_resolution_clock::now();
+
+        if (!options.quiet && status_code == 0)
+        {
+            duration<float> d = t2 - t1;
+            std::cout << "Compiled on server in: " << std::setprecision(4)
+                      << std::fixed << d.count() << " seconds" << std::endl;
+        }
+
+        return status_code;
+    }
+
+    std::unique_ptr<Cache> cache{};
+    if (options.cache)
+    {
+        if (options.cache_directory.empty())
+        {
+            options.cache_directory = Cache::get_default_directory();
+        }
+
+        // NOTE: Not being able to cache anything isn't an error, the files
+        // are compiled as if --no-cache had been given instead
+        std::error_code error{};
+        if (!options.cache_directory.empty())
+        {
+            std::filesystem::create_directories(options.cache_directory, error);
+        }
+
+        if (error && !options.quiet)
+        {
+            std::cout << "Not using the cache, could not create '"
+                      << options.cache_directory << "': " << error.message()
+                      << std::endl;
+        }
+        else if (!error && !options.cache_directory.empty())
+        {
+            cache = std::make_unique<Cache>(options.cache_directory,
+                                            options.cache_size << 20);
+        }
+    }
+
+    if (inputs.empty() && options.cache_statistics && cache)
+    {
+        cache->print_statistics(std::cout);
+        return 0;
+    }
+
+    if (inputs.empty())
+    {
+        std::cout << "Please provide an input file" << std::endl;
+        std::exit(0);
+    }
+
+    if (!directory.empty())
+    {
+        compile_batch(inputs, directory, options, cache.get());
+    }
+    else
+    {
+        std::unique_ptr<ThreadPool> thread_pool{};
+        if (options.jobs > 1)
+        {
+            thread_pool = std::make_unique<ThreadPool>(options.jobs);
+        }
+
+        compile(inputs[0], "out", options, thread_pool.get(), cache.get());
+    }
+
+    if (options.cache_statistics && cache)
+    {
+        cache->print_statistics(std::cout);
     }
 }
+
@@ -0,0 +1,129 @@
+#include "Error/Error.h"
+#include "Optimizer/Optimizer.h"
+#include "Quads/Quads.h"
+#include <tuple>
+
+namespace
+{
+
+bool is_expression(Quad::Operation operation)
+{
+    switch (operation)
+    {
+    case Quad::Operation::I_ADD:
+    case Quad::Operation::I_MINUS:
+    case Quad::Operation::I_MULTIPLICATION:
+    case Quad::Operation::I_DIVISION:
+    case Quad::Operation::LESSER_THAN:
+    case Quad::Operation::LESSER_THAN_OR_EQUAL:
+    case Quad::Operation::EQUAL:
+    case Quad::Operation::GREATER_THAN:
+    case Quad::Operation::GREATER_THAN_OR_EQUAL:
+    case Quad::Operation::UNARY_MINUS: return true;
+    default: return false;
+    }
+}
+
+bool is_commutative(Quad::Operation operation)
+{
+    return operation == Quad::Operation::I_ADD ||
+           operation == Quad::Operation::I_MULTIPLICATION ||
+           operation == Quad::Operation::EQUAL;
+}
+
+} // namespace
+
+bool Optimizer::eliminate_common_subexpressions(int function_index,
+                                                std::vector<Quad *> &quads)
+{
+    // NOTE: Local value numbering light. Within a basic block we remember
+    // which symbol already holds the result of each expression, and which
+    // symbols are plain copies of others. A repeated expression becomes a copy
+    // of the earlier result, and uses of a copy read the original instead, so
+    // the copy can be removed as dead code afterwards.
+
+    using Expression = std::tuple<Quad::Operation, long, long>;
+
+    bool changed = false;
+
+    std::map<Expression, long> available{};
+    std::map<long, long>       copies{};
+
+    auto forget = [&](long symbol_index)
+    {
+        copies.erase(symbol_index);
+
+        for (auto it = copies.begin(); it != copies.end();)
+        {
+            it = it->second == symbol_index ? copies.erase(it) : std::next(it);
+        }
+
+        for (auto it = available.begin(); it != available.end();)
+        {
+            auto const &[operation, operand1, operand2] = it->first;
+
+            bool stale = it->second == symbol_index ||
+                         operand1 == symbol_index || operand2 == symbol_index;
+
+            it = stale ? available.erase(it) : std::next(it);
+        }
+    };
+
+    for (Quad *quad : quads)
+    {
+        if (quad->operation == Quad::Operation::LABEL)
+        {
+            available.clear();
+            copies.clear();
+            continue;
+        }
+
+        for (long *use : quad->use_operands())
+        {
+            if (copies.count(*use) == 1)
+            {
+                *use    = copies[*use];
+                changed = true;
+            }
+        }
+
+        long definition = quad->definition();
+
+        Expression expression{quad->operation, quad->operand1, quad->operand2};
+        if (is_commutative(quad->operation) && quad->operand2 < quad->operand1)
+        {
+            expression = {quad->operation, quad->operand2, quad->operand1};
+        }
+
+        if (is_expression(quad->operation) && available.count(expression) == 1)
+        {
+            quad->operation = Quad::Operation::ASSIGN;
+            quad->operand1  = available[expression];
+            quad->operand2  = -1;
+            changed         = true;
+        }
+
+        if (definition == -1)
+        {
+            continue;
+        }
+
+        forget(definition);
+
+        if (is_expression(quad->operation) &&
+            std::get<1>(expression) != definition &&
+            std::get<2>(expression) != definition)
+        {
+            available[expression] = definition;
+        }
+
+        if (quad->operation == Quad::Operation::ASSIGN &&
+            symbol_table->is_local(quad->operand1, function_index) &&
+            quad->operand1 != definition)
+        {
+            copies[definition] = quad->operand1;
+        }
+    }
+
+    return changed;
+}
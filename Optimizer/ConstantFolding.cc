@@ -0,0 +1,176 @@
+#include "Error/Error.h"
+#include "Optimizer/Optimizer.h"
+#include "Quads/Quads.h"
+
+bool Optimizer::fold_constants(std::vector<Quad *> &quads)
+{
+    // NOTE: Tracks which symbols hold a known value within a basic block, and
+    // replaces the quads that only depend on known values with an I_STORE of
+    // the result. An IF on a known condition becomes either nothing or a JUMP,
+    // and so does a call to a pure function with known arguments.
+
+    bool changed = false;
+
+    std::map<long, long> constants{};
+
+    std::vector<Quad *> result{};
+
+    auto is_constant = [&](long symbol_index)
+    { return constants.count(symbol_index) == 1; };
+
+    for (Quad *quad : quads)
+    {
+        if (quad->operation == Quad::Operation::LABEL)
+        {
+            // NOTE: We don't know where we came from
+            constants.clear();
+            result.push_back(quad);
+            continue;
+        }
+
+        switch (quad->operation)
+        {
+        case Quad::Operation::I_ADD:
+        case Quad::Operation::I_MINUS:
+        case Quad::Operation::I_MULTIPLICATION:
+        case Quad::Operation::I_DIVISION:
+        case Quad::Operation::LESSER_THAN:
+        case Quad::Operation::LESSER_THAN_OR_EQUAL:
+        case Quad::Operation::EQUAL:
+        case Quad::Operation::GREATER_THAN:
+        case Quad::Operation::GREATER_THAN_OR_EQUAL:
+        {
+            long value;
+
+            if (is_constant(quad->operand1) && is_constant(quad->operand2) &&
+                evaluate_operation(quad->operation, constants[quad->operand1],
+                                   constants[quad->operand2], value))
+            {
+                quad->operation = Quad::Operation::I_STORE;
+                quad->operand1  = value;
+                quad->operand2  = -1;
+                changed         = true;
+            }
+
+            break;
+        }
+        case Quad::Operation::I_MULTIPLICATION_IMMEDIATE:
+        case Quad::Operation::I_DIVISION_IMMEDIATE:
+        {
+            long value;
+
+            if (is_constant(quad->operand1) &&
+                evaluate_operation(quad->operation, constants[quad->operand1],
+                                   quad->operand2, value))
+            {
+                quad->operation = Quad::Operation::I_STORE;
+                quad->operand1  = value;
+                quad->operand2  = -1;
+                changed         = true;
+            }
+
+            break;
+        }
+        case Quad::Operation::UNARY_MINUS:
+        case Quad::Operation::ASSIGN:
+        {
+            if (is_constant(quad->operand1))
+            {
+                unsigned long value = constants[quad->operand1];
+
+                if (quad->operation == Quad::Operation::UNARY_MINUS)
+                {
+                    value = -value;
+                }
+
+                quad->operation = Quad::Operation::I_STORE;
+                quad->operand1  = value;
+                changed         = true;
+            }
+
+            break;
+        }
+        case Quad::Operation::FUNCTION_CALL:
+        {
+            // NOTE: A pure function called with known arguments can be run
+            // right here, and the call replaced with its result
+            FunctionSymbol *function =
+                symbol_table->get_function_symbol(quad->operand1);
+
+            int first_argument = result.size() - function->parameter_count;
+            ASSERT(first_argument >= 0);
+
+            std::vector<long> arguments{};
+            for (int a = first_argument; a < result.size(); a++)
+            {
+                if (is_constant(result[a]->operand1))
+                {
+                    arguments.push_back(constants[result[a]->operand1]);
+                }
+            }
+
+            long value = 0;
+            int  steps = 0;
+
+            if (!function->is_pure ||
+                arguments.size() != function->parameter_count ||
+                !evaluate_call(quad->operand1, arguments, value, steps, 0))
+            {
+                break;
+            }
+
+            result.resize(first_argument);
+            changed = true;
+
+            if (quad->dest == -1)
+            {
+                continue;
+            }
+
+            quad->operation = Quad::Operation::I_STORE;
+            quad->operand1  = value;
+
+            break;
+        }
+        case Quad::Operation::IF:
+        {
+            if (!is_constant(quad->operand1))
+            {
+                break;
+            }
+
+            changed = true;
+
+            if (constants[quad->operand1] == 1)
+            {
+                // NOTE: Always runs the body
+                continue;
+            }
+
+            quad->operation = Quad::Operation::JUMP;
+            quad->operand1  = quad->operand2;
+            quad->operand2  = -1;
+
+            break;
+        }
+        default: break;
+        }
+
+        long definition = quad->definition();
+        if (definition != -1)
+        {
+            constants.erase(definition);
+        }
+
+        if (quad->operation == Quad::Operation::I_STORE)
+        {
+            constants[quad->dest] = quad->operand1;
+        }
+
+        result.push_back(quad);
+    }
+
+    quads = result;
+
+    return changed;
+}
@@ -0,0 +1,94 @@
+#include "Error/Error.h"
+#include "Optimizer/Optimizer.h"
+#include "Quads/Quads.h"
+#include "RegisterAllocator/Liveness.h"
+#include <set>
+
+bool Optimizer::eliminate_dead_code(int                  function_index,
+                                    std::vector<Quad *> &quads)
+{
+    // NOTE: Removes quads whose result is never read, code that can't be
+    // reached because it follows a JUMP or RETURN, jumps to the very next
+    // quad and labels nothing jumps to.
+
+    std::vector<Quad *> result{};
+
+    Liveness liveness{symbol_table, function_index, quads};
+
+    bool reachable = true;
+
+    for (int i = 0; i < quads.size(); i++)
+    {
+        Quad *quad = quads[i];
+
+        if (quad->operation == Quad::Operation::LABEL)
+        {
+            reachable = true;
+        }
+
+        if (!reachable)
+        {
+            continue;
+        }
+
+        if (quad->operation == Quad::Operation::JUMP ||
+            quad->operation == Quad::Operation::RETURN)
+        {
+            reachable = false;
+        }
+
+        // NOTE: Calls are kept even if the result isn't used, they might print
+        long definition = quad->definition();
+        bool is_dead =
+            symbol_table->is_local(definition, function_index) &&
+            liveness.live_after(i).count(definition) == 0;
+
+        if (is_dead && quad->operation != Quad::Operation::FUNCTION_CALL)
+        {
+            continue;
+        }
+
+        result.push_back(quad);
+    }
+
+    std::set<long> targets{};
+
+    for (int i = 0; i < result.size(); i++)
+    {
+        Quad *quad = result[i];
+
+        if (quad->operation == Quad::Operation::JUMP && i + 1 < result.size() &&
+            result[i + 1]->operation == Quad::Operation::LABEL &&
+            result[i + 1]->operand1 == quad->operand1)
+        {
+            result.erase(result.begin() + i--);
+            continue;
+        }
+
+        if (quad->operation == Quad::Operation::JUMP)
+        {
+            targets.insert(quad->operand1);
+        }
+        else if (quad->operation == Quad::Operation::IF)
+        {
+            targets.insert(quad->operand2);
+        }
+    }
+
+    std::vector<Quad *> used{};
+
+    for (Quad *quad : result)
+    {
+        if (quad->operation != Quad::Operation::LABEL ||
+            targets.count(quad->operand1) == 1)
+        {
+            used.push_back(quad);
+        }
+    }
+
+    bool changed = used.size() != quads.size();
+
+    quads = used;
+
+    return changed;
+}
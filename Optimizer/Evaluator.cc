@@ -0,0 +1,265 @@
+#include "Error/Error.h"
+#include "Optimizer/Optimizer.h"
+#include "Quads/Quads.h"
+#include "SymbolTable/Symbol.h"
+#include <algorithm>
+#include <climits>
+#include <unordered_map>
+
+bool Optimizer::evaluate_operation(Quad::Operation operation, long a, long b,
+                                   long &result)
+{
+    // NOTE: Wrap around on overflow like the hardware does, instead of running
+    // into undefined behaviour in the compiler
+    unsigned long ua = a;
+    unsigned long ub = b;
+
+    switch (operation)
+    {
+    case Quad::Operation::I_ADD: result = ua + ub; return true;
+    case Quad::Operation::I_MINUS: result = ua - ub; return true;
+    case Quad::Operation::I_MULTIPLICATION:
+    case Quad::Operation::I_MULTIPLICATION_IMMEDIATE:
+    {
+        result = ua * ub;
+        return true;
+    }
+    case Quad::Operation::I_DIVISION:
+    case Quad::Operation::I_DIVISION_IMMEDIATE:
+    {
+        if (b == 0 || (a == LONG_MIN && b == -1))
+        {
+            return false;
+        }
+
+        result = a / b;
+        return true;
+    }
+    case Quad::Operation::LESSER_THAN: result = a < b; return true;
+    case Quad::Operation::LESSER_THAN_OR_EQUAL: result = a <= b; return true;
+    case Quad::Operation::EQUAL: result = a == b; return true;
+    case Quad::Operation::GREATER_THAN: result = a > b; return true;
+    case Quad::Operation::GREATER_THAN_OR_EQUAL: result = a >= b; return true;
+    default: return false;
+    }
+}
+
+bool Optimizer::is_pure(int                        function_index,
+                        std::vector<Quad *> const &quads) const
+{
+    // NOTE: A function is pure if it only reads and writes its own variables
+    // and parameters, and only calls itself and other pure functions. The
+    // print functions are predefined and never marked as pure.
+    auto is_global = [&](long symbol_index)
+    {
+        return symbol_index != -1 &&
+               symbol_table->get_symbol(symbol_index)->tag ==
+                   Symbol::Tag::Variable &&
+               !symbol_table->is_local(symbol_index, function_index);
+    };
+
+    for (Quad const *quad : quads)
+    {
+        std::vector<long> uses = quad->uses();
+
+        if (is_global(quad->definition()) ||
+            std::any_of(uses.begin(), uses.end(), is_global))
+        {
+            return false;
+        }
+
+        if (quad->operation == Quad::Operation::FUNCTION_CALL &&
+            quad->operand1 != function_index &&
+            !symbol_table->get_function_symbol(quad->operand1)->is_pure)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool Optimizer::evaluate_call(int                      function_index,
+                              std::vector<long> const &arguments, long &result,
+                              int &steps, int depth)
+{
+    // NOTE: A small interpreter for the optimized quads of a pure function.
+    // Gives up if the function runs for too long, recurses too deeply or would
+    // trap at runtime, in which case the call is simply left in the program.
+
+    auto body = bodies.find(function_index);
+    if (body == bodies.end() || depth > MAX_EVALUATION_DEPTH)
+    {
+        return false;
+    }
+
+    if (depth == 0 && unevaluable.count({function_index, arguments}) == 1)
+    {
+        return false;
+    }
+
+    std::vector<Quad *> const &quads = body->second;
+
+    std::map<long, int> labels{};
+    for (int i = 0; i < quads.size(); i++)
+    {
+        if (quads[i]->operation == Quad::Operation::LABEL)
+        {
+            labels[quads[i]->operand1] = i;
+        }
+    }
+
+    std::unordered_map<long, long> values{};
+
+    FunctionSymbol *function =
+        symbol_table->get_function_symbol(function_index);
+
+    int parameter = function->first_parameter;
+    for (long argument : arguments)
+    {
+        values[parameter] = argument;
+        parameter =
+            symbol_table->get_parameter_symbol(parameter)->next_parameter;
+    }
+
+    std::vector<long> pending_arguments{};
+
+    result = 0;
+
+    int  i  = 0;
+    bool ok = true;
+
+    // NOTE: A symbol that hasn't been assigned yet holds a value we know
+    // nothing about, so reading one gives up instead of assuming it is 0
+    auto read = [&](long symbol_index) -> long
+    {
+        auto it = values.find(symbol_index);
+
+        if (it == values.end())
+        {
+            ok = false;
+            return 0;
+        }
+
+        return it->second;
+    };
+
+    while (ok && i < quads.size())
+    {
+        if (++steps > MAX_EVALUATION_STEPS)
+        {
+            ok = false;
+            break;
+        }
+
+        Quad const *quad = quads[i++];
+
+        switch (quad->operation)
+        {
+        case Quad::Operation::I_STORE:
+        {
+            values[quad->dest] = quad->operand1;
+            break;
+        }
+        case Quad::Operation::ASSIGN:
+        {
+            values[quad->dest] = read(quad->operand1);
+            break;
+        }
+        case Quad::Operation::UNARY_MINUS:
+        {
+            values[quad->dest] = -(unsigned long)read(quad->operand1);
+            break;
+        }
+        case Quad::Operation::I_ADD:
+        case Quad::Operation::I_MINUS:
+        case Quad::Operation::I_MULTIPLICATION:
+        case Quad::Operation::I_DIVISION:
+        case Quad::Operation::LESSER_THAN:
+        case Quad::Operation::LESSER_THAN_OR_EQUAL:
+        case Quad::Operation::EQUAL:
+        case Quad::Operation::GREATER_THAN:
+        case Quad::Operation::GREATER_THAN_OR_EQUAL:
+        {
+            long a = read(quad->operand1);
+            long b = read(quad->operand2);
+
+            ok = ok && evaluate_operation(quad->operation, a, b,
+                                          values[quad->dest]);
+            break;
+        }
+        case Quad::Operation::I_MULTIPLICATION_IMMEDIATE:
+        case Quad::Operation::I_DIVISION_IMMEDIATE:
+        {
+            long a = read(quad->operand1);
+
+            ok = ok && evaluate_operation(quad->operation, a, quad->operand2,
+                                          values[quad->dest]);
+            break;
+        }
+        case Quad::Operation::ARGUMENT:
+        {
+            pending_arguments.push_back(read(quad->operand1));
+            break;
+        }
+        case Quad::Operation::FUNCTION_CALL:
+        {
+            long value = 0;
+            ok = evaluate_call(quad->operand1, pending_arguments, value, steps,
+                               depth + 1);
+
+            pending_arguments.clear();
+
+            if (quad->dest != -1)
+            {
+                values[quad->dest] = value;
+            }
+
+            break;
+        }
+        case Quad::Operation::IF:
+        {
+            if (read(quad->operand1) != 1)
+            {
+                i = labels.at(quad->operand2);
+            }
+
+            break;
+        }
+        case Quad::Operation::JUMP:
+        {
+            i = labels.at(quad->operand1);
+            break;
+        }
+        case Quad::Operation::RETURN:
+        {
+            if (quad->operand1 != -1)
+            {
+                result = read(quad->operand1);
+            }
+
+            if (ok)
+            {
+                return true;
+            }
+
+            break;
+        }
+        case Quad::Operation::LABEL: break;
+        default: ok = false;
+        }
+    }
+
+    // NOTE: Falling off the end is an implicit return
+    if (ok)
+    {
+        return true;
+    }
+
+    if (depth == 0)
+    {
+        unevaluable.insert({function_index, arguments});
+    }
+
+    return false;
+}
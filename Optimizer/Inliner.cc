@@ -0,0 +1,239 @@
+#include "Error/Error.h"
+#include "Optimizer/Optimizer.h"
+#include "Quads/Quads.h"
+#include "SymbolTable/Symbol.h"
+#include <algorithm>
+#include <set>
+
+bool Optimizer::should_inline(int callee, int call_sites) const
+{
+    auto body = bodies.find(callee);
+
+    // NOTE: Predefined functions like print, and the function that is being
+    // compiled right now, don't have any quads we could copy. A recursive
+    // callee keeps calling itself from the copied body, so it is only ever
+    // unrolled one level.
+    if (body == bodies.end() || inline_depth.at(callee) >= MAX_INLINE_DEPTH)
+    {
+        return false;
+    }
+
+    int size = 0;
+    for (Quad const *quad : body->second)
+    {
+        if (quad->operation != Quad::Operation::LABEL)
+        {
+            size += 1;
+        }
+    }
+
+    FunctionSymbol *function = symbol_table->get_function_symbol(callee);
+
+    // NOTE: Every argument is an ARGUMENT quad we get rid of. If the body is
+    // no bigger than the call, inlining it is always a win.
+    int growth = size - (function->parameter_count + CALL_OVERHEAD);
+    if (growth <= 0)
+    {
+        return true;
+    }
+
+    // NOTE: Otherwise the body gets copied once per call site, so a function
+    // that is called from many places has to be that much smaller
+    return growth * call_sites <= options.inline_threshold;
+}
+
+void Optimizer::inline_call(int callee, Quad const *call,
+                            std::vector<long> const &arguments,
+                            std::vector<Quad *>     &result)
+{
+    FunctionSymbol *function = symbol_table->get_function_symbol(callee);
+    std::vector<Quad *> const &body = bodies.at(callee);
+
+    std::map<long, long> renamed{};
+    std::map<long, long> labels{};
+
+    std::set<long> written{};
+    for (Quad const *quad : body)
+    {
+        written.insert(quad->definition());
+    }
+
+    // NOTE: Parameters the callee only reads can refer straight to the
+    // arguments. The ones it writes to get a temporary of their own, so the
+    // caller's variables aren't changed behind its back.
+    int parameter = function->first_parameter;
+    for (long argument : arguments)
+    {
+        if (written.count(parameter) == 0)
+        {
+            renamed[parameter] = argument;
+        }
+        else
+        {
+            int type = symbol_table->get_symbol(parameter)->type;
+            int copy = symbol_table->generate_temporary_variable(type);
+
+            result.push_back(
+                new Quad(Quad::Operation::ASSIGN, argument, -1, copy));
+            renamed[parameter] = copy;
+        }
+
+        parameter =
+            symbol_table->get_parameter_symbol(parameter)->next_parameter;
+    }
+
+    // NOTE: Every variable of the callee becomes a temporary in the caller's
+    // activation record. Function symbols and variables of enclosing scopes
+    // are left as they are.
+    auto rename = [&](long symbol_index) -> long
+    {
+        if (!symbol_table->is_local(symbol_index, callee))
+        {
+            return symbol_index;
+        }
+
+        if (renamed.count(symbol_index) == 0)
+        {
+            int type = symbol_table->get_symbol(symbol_index)->type;
+            renamed[symbol_index] =
+                symbol_table->generate_temporary_variable(type);
+        }
+
+        return renamed[symbol_index];
+    };
+
+    auto rename_label = [&](long label) -> long
+    {
+        if (labels.count(label) == 0)
+        {
+            labels[label] = symbol_table->get_next_label();
+        }
+
+        return labels[label];
+    };
+
+    int exit_label = -1;
+
+    for (int i = 0; i < body.size(); i++)
+    {
+        Quad *quad = new Quad(*body[i]);
+
+        switch (quad->operation)
+        {
+        case Quad::Operation::LABEL:
+        case Quad::Operation::JUMP:
+        {
+            quad->operand1 = rename_label(quad->operand1);
+            break;
+        }
+        case Quad::Operation::IF:
+        {
+            quad->operand1 = rename(quad->operand1);
+            quad->operand2 = rename_label(quad->operand2);
+            break;
+        }
+        case Quad::Operation::RETURN:
+        {
+            // NOTE: Returning means storing the result where the call would
+            // have put it, and leaving the inlined body
+            if (call->dest != -1 && quad->operand1 != -1)
+            {
+                result.push_back(new Quad(Quad::Operation::ASSIGN,
+                                          rename(quad->operand1), -1,
+                                          call->dest));
+            }
+
+            if (i + 1 < body.size())
+            {
+                if (exit_label == -1)
+                {
+                    exit_label = symbol_table->get_next_label();
+                }
+
+                result.push_back(
+                    new Quad(Quad::Operation::JUMP, exit_label, -1, -1));
+            }
+
+            delete quad;
+            continue;
+        }
+        default:
+        {
+            for (long *use : quad->use_operands())
+            {
+                *use = rename(*use);
+            }
+
+            if (quad->definition() != -1)
+            {
+                quad->dest = rename(quad->dest);
+            }
+        }
+        }
+
+        result.push_back(quad);
+    }
+
+    if (exit_label != -1)
+    {
+        result.push_back(new Quad(Quad::Operation::LABEL, exit_label, -1, -1));
+    }
+}
+
+bool Optimizer::inline_calls(int function_index, std::vector<Quad *> &quads)
+{
+    // NOTE: Replace calls to small functions with a copy of their body. This
+    // saves the whole call sequence, and more importantly lets the other
+    // passes see the arguments, so constants can be folded through the body.
+
+    std::map<int, int> call_sites{};
+    for (Quad const *quad : quads)
+    {
+        if (quad->operation == Quad::Operation::FUNCTION_CALL)
+        {
+            call_sites[quad->operand1] += 1;
+        }
+    }
+
+    int depth = 0;
+
+    std::vector<Quad *> result{};
+
+    for (Quad *quad : quads)
+    {
+        if (quad->operation != Quad::Operation::FUNCTION_CALL ||
+            !should_inline(quad->operand1, call_sites[quad->operand1]))
+        {
+            result.push_back(quad);
+            continue;
+        }
+
+        FunctionSymbol *function =
+            symbol_table->get_function_symbol(quad->operand1);
+
+        // NOTE: The ARGUMENT quads always come right before their call
+        int first_argument = result.size() - function->parameter_count;
+        ASSERT(first_argument >= 0);
+
+        std::vector<long> arguments{};
+        for (int a = first_argument; a < result.size(); a++)
+        {
+            ASSERT(result[a]->operation == Quad::Operation::ARGUMENT);
+            arguments.push_back(result[a]->operand1);
+        }
+
+        result.resize(first_argument);
+
+        inline_call(quad->operand1, quad, arguments, result);
+
+        depth = std::max(depth, inline_depth[quad->operand1] + 1);
+    }
+
+    inline_depth[function_index] = depth;
+
+    bool changed = result.size() != quads.size() || depth > 0;
+
+    quads = result;
+
+    return changed;
+}
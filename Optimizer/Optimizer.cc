@@ -0,0 +1,91 @@
+#include "Optimizer.h"
+#include "Error/Error.h"
+#include "Quads/Quads.h"
+#include "SymbolTable/Symbol.h"
+#include "SymbolTable/SymbolTable.h"
+
+namespace
+{
+
+template <typename Pass>
+bool run(Statistics *statistics, char const *phase, Pass pass)
+{
+    Statistics::Timer timer{statistics, phase};
+    return pass();
+}
+
+} // namespace
+
+Optimizer::Optimizer(SymbolTable *symbol_table, Options const &options,
+                     Statistics *statistics)
+    : symbol_table{symbol_table}, options{options}, statistics{statistics}
+{}
+
+void Optimizer::optimize(Quads &quads)
+{
+    if (options.optimization_level < 2)
+    {
+        return;
+    }
+
+    int                 function_index = symbol_table->enclosing_scope();
+    std::vector<Quad *> function_quads = quads.get_pending_quads();
+
+    run(statistics, "optimize.tail_recursion",
+        [&]
+        { return eliminate_tail_recursion(function_index, function_quads); });
+
+    // NOTE: Calls that can be evaluated right away are better off as
+    // constants than as inlined bodies, so fold them first
+    run(statistics, "optimize.constant_folding",
+        [&] { return fold_constants(function_quads); });
+    run(statistics, "optimize.inlining",
+        [&] { return inline_calls(function_index, function_quads); });
+
+    // NOTE: The passes feed each other, folding a constant can make two
+    // expressions equal and removing a copy can expose another constant. So
+    // we keep going until nothing changes, but give up eventually.
+    for (int round = 0; round < 8; round++)
+    {
+        bool folded = run(statistics, "optimize.constant_folding",
+                          [&] { return fold_constants(function_quads); });
+        bool eliminated =
+            run(statistics, "optimize.common_subexpressions",
+                [&] {
+                    return eliminate_common_subexpressions(function_index,
+                                                           function_quads);
+                });
+        bool removed =
+            run(statistics, "optimize.dead_code",
+                [&] {
+                    return eliminate_dead_code(function_index, function_quads);
+                });
+
+        if (!folded && !eliminated && !removed)
+        {
+            break;
+        }
+    }
+
+    // NOTE: Done last, since the immediate forms hide the constant operand
+    // from the passes above
+    if (run(statistics, "optimize.strength_reduction",
+            [&] { return reduce_strength(function_quads); }))
+    {
+        run(statistics, "optimize.dead_code", [&]
+            { return eliminate_dead_code(function_index, function_quads); });
+    }
+
+    bodies[function_index] = function_quads;
+
+    symbol_table->get_function_symbol(function_index)->is_pure =
+        is_pure(function_index, function_quads);
+
+    quads.replace_pending_quads(function_quads);
+}
+
+bool Optimizer::keeps_bodies() const
+{
+    return options.optimization_level >= 2;
+}
+
@@ -0,0 +1,79 @@
+#pragma once
+
+#include "Options/Options.h"
+#include "Quads/Quads.h"
+#include "Statistics/Statistics.h"
+#include "SymbolTable/Symbol.h"
+#include "SymbolTable/SymbolTable.h"
+#include <map>
+#include <set>
+#include <utility>
+#include <vector>
+
+// NOTE: Runs machine independent passes over the quads of each function
+// after they have been generated, and before the code generator sees them
+class Optimizer
+{
+  public:
+    // NOTE: With statistics, every pass is timed on its own
+    Optimizer(SymbolTable *symbol_table, Options const &options,
+              Statistics *statistics = nullptr);
+
+    void optimize(Quads &quads);
+
+    // NOTE: Whether the optimized quads of each function are kept, so that
+    // they can be inlined into the functions defined after it
+    bool keeps_bodies() const;
+
+  private:
+    bool eliminate_tail_recursion(int function_index, std::vector<Quad *> &);
+    bool inline_calls(int function_index, std::vector<Quad *> &);
+    bool fold_constants(std::vector<Quad *> &);
+    bool eliminate_common_subexpressions(int function_index,
+                                         std::vector<Quad *> &);
+    bool eliminate_dead_code(int function_index, std::vector<Quad *> &);
+    bool reduce_strength(std::vector<Quad *> &);
+
+    bool should_inline(int callee, int call_sites) const;
+    void inline_call(int callee, Quad const *call, std::vector<long> const &,
+                     std::vector<Quad *> &result);
+
+    bool is_pure(int function_index, std::vector<Quad *> const &) const;
+
+    bool evaluate_call(int function_index, std::vector<long> const &arguments,
+                       long &result, int &steps, int depth);
+
+    // NOTE: Computes the result of an operation on two known values the same
+    // way the generated code would. Returns false for the cases that trap at
+    // runtime, those are left for the program to run into.
+    static bool evaluate_operation(Quad::Operation, long, long, long &result);
+
+    // NOTE: The optimized quads of every function compiled so far. Functions
+    // have to be defined before they are called, so every callee that isn't
+    // recursive can be found here.
+    std::map<int, std::vector<Quad *>> bodies{};
+
+    // NOTE: How deeply nested the inlined calls in each body are, which keeps
+    // chains of small functions from growing without bound
+    std::map<int, int> inline_depth{};
+
+    static int const MAX_INLINE_DEPTH = 4;
+
+    // NOTE: How many quads, and how many nested calls, the compile time
+    // evaluation of a single call may go through before giving up. Counting
+    // steps instead of measuring time keeps the output deterministic.
+    static int const MAX_EVALUATION_STEPS = 1 << 18;
+    static int const MAX_EVALUATION_DEPTH = 4096;
+
+    // NOTE: Calls we already tried and failed to evaluate, so we don't spend
+    // the whole budget on them again in every round
+    std::set<std::pair<int, std::vector<long>>> unevaluable{};
+
+    // NOTE: The quads a call replaces on top of its arguments. The call itself,
+    // the prologue and the epilogue.
+    static int const CALL_OVERHEAD = 3;
+
+    SymbolTable *symbol_table;
+    Options      options;
+    Statistics  *statistics;
+};
@@ -0,0 +1,92 @@
+#include "Error/Error.h"
+#include "Optimizer/Optimizer.h"
+#include "Quads/Quads.h"
+
+bool Optimizer::reduce_strength(std::vector<Quad *> &quads)
+{
+    // NOTE: Multiplications and divisions where one side is a known value are
+    // turned into their immediate versions, which the code generator can
+    // implement with shifts, lea and multiplication by a magic number instead
+    // of imul and idiv. The trivial cases are taken care of right here.
+
+    bool changed = false;
+
+    std::map<long, long> constants{};
+
+    for (Quad *quad : quads)
+    {
+        if (quad->operation == Quad::Operation::LABEL)
+        {
+            constants.clear();
+            continue;
+        }
+
+        if (quad->operation == Quad::Operation::I_MULTIPLICATION &&
+            constants.count(quad->operand1) == 1 &&
+            constants.count(quad->operand2) == 0)
+        {
+            std::swap(quad->operand1, quad->operand2);
+        }
+
+        bool is_multiplication =
+            quad->operation == Quad::Operation::I_MULTIPLICATION;
+        bool is_division = quad->operation == Quad::Operation::I_DIVISION;
+
+        long value = constants.count(quad->operand2) == 1
+                         ? constants[quad->operand2]
+                         : 0;
+
+        // NOTE: Dividing by zero, or the smallest integer by -1, has to trap
+        // just like before, so those are left to idiv
+        if (is_division && (value == 0 || value == -1))
+        {
+            is_division = false;
+        }
+
+        if ((is_multiplication || is_division) &&
+            constants.count(quad->operand2) == 1)
+        {
+            changed = true;
+
+            if (is_multiplication && value == 0)
+            {
+                quad->operation = Quad::Operation::I_STORE;
+                quad->operand1  = 0;
+                quad->operand2  = -1;
+            }
+            else if (value == 1)
+            {
+                quad->operation = Quad::Operation::ASSIGN;
+                quad->operand2  = -1;
+            }
+            else if (is_multiplication && value == -1)
+            {
+                quad->operation = Quad::Operation::UNARY_MINUS;
+                quad->operand2  = -1;
+            }
+            else if (is_multiplication)
+            {
+                quad->operation = Quad::Operation::I_MULTIPLICATION_IMMEDIATE;
+                quad->operand2  = value;
+            }
+            else
+            {
+                quad->operation = Quad::Operation::I_DIVISION_IMMEDIATE;
+                quad->operand2  = value;
+            }
+        }
+
+        long definition = quad->definition();
+        if (definition != -1)
+        {
+            constants.erase(definition);
+        }
+
+        if (quad->operation == Quad::Operation::I_STORE)
+        {
+            constants[quad->dest] = quad->operand1;
+        }
+    }
+
+    return changed;
+}
@@ -0,0 +1,95 @@
+#include "Error/Error.h"
+#include "Optimizer/Optimizer.h"
+#include "Quads/Quads.h"
+#include "SymbolTable/Symbol.h"
+
+bool Optimizer::eliminate_tail_recursion(int                  function_index,
+                                         std::vector<Quad *> &quads)
+{
+    // NOTE: A function that calls itself as the very last thing it does
+    // doesn't need a new activation record. We overwrite the parameters with
+    // the new arguments and jump back to the beginning of the body, turning
+    // the recursion into a loop.
+
+    FunctionSymbol *function =
+        symbol_table->get_function_symbol(function_index);
+
+    int entry_label = -1;
+
+    std::vector<Quad *> result{};
+
+    for (int i = 0; i < quads.size(); i++)
+    {
+        Quad *quad = quads[i];
+
+        if (quad->operand1 != function_index || !is_tail_call(quads, i))
+        {
+            result.push_back(quad);
+            continue;
+        }
+
+        if (entry_label == -1)
+        {
+            entry_label = symbol_table->get_next_label();
+        }
+
+        // NOTE: The ARGUMENT quads always come right before their call
+        int first_argument = result.size() - function->parameter_count;
+        ASSERT(first_argument >= 0);
+
+        std::vector<long> arguments{};
+        for (int a = first_argument; a < result.size(); a++)
+        {
+            ASSERT(result[a]->operation == Quad::Operation::ARGUMENT);
+            arguments.push_back(result[a]->operand1);
+        }
+
+        result.resize(first_argument);
+
+        // NOTE: An argument can be one of the parameters we are about to
+        // overwrite, e.g. f(b, a), so those are copied out of the way first
+        for (long &argument : arguments)
+        {
+            Symbol *symbol = symbol_table->get_symbol(argument);
+
+            if (symbol->tag == Symbol::Tag::Parameter)
+            {
+                int copy =
+                    symbol_table->generate_temporary_variable(symbol->type);
+                result.push_back(
+                    new Quad(Quad::Operation::ASSIGN, argument, -1, copy));
+                argument = copy;
+            }
+        }
+
+        int parameter = function->first_parameter;
+        for (long argument : arguments)
+        {
+            result.push_back(
+                new Quad(Quad::Operation::ASSIGN, argument, -1, parameter));
+            parameter = symbol_table->get_parameter_symbol(parameter)
+                            ->next_parameter;
+        }
+
+        result.push_back(new Quad(Quad::Operation::JUMP, entry_label, -1, -1));
+
+        // NOTE: The return after the call is never reached
+        if (i + 1 < quads.size() &&
+            quads[i + 1]->operation == Quad::Operation::RETURN)
+        {
+            i++;
+        }
+    }
+
+    if (entry_label == -1)
+    {
+        return false;
+    }
+
+    result.insert(result.begin(),
+                  new Quad(Quad::Operation::LABEL, entry_label, -1, -1));
+
+    quads = result;
+
+    return true;
+}
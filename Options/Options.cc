@@ -0,0 +1,84 @@
+#include "Options.h"
+#include <algorithm>
+
+void parse_option(Options &options, std::string const &argument)
+{
+    if (argument == "--quiet")
+    {
+        options.quiet = true;
+    }
+    else if (argument == "-O0" || argument == "-O1" ||
+             argument == "-O2" || argument == "-O3")
+    {
+        options.optimization_level = argument[2] - '0';
+    }
+    else if (argument == "--calling-convention=sysv")
+    {
+        options.register_arguments = true;
+    }
+    else if (argument == "--calling-convention=stack")
+    {
+        options.register_arguments = false;
+    }
+    else if (argument == "--spill-report")
+    {
+        options.spill_report = true;
+    }
+    else if (argument == "--peephole-report")
+    {
+        options.peephole_report = true;
+    }
+    else if (argument == "--emit=asm")
+    {
+        options.emit_assembler = true;
+    }
+    else if (argument == "--emit=exe")
+    {
+        options.emit_assembler = false;
+    }
+    else if (argument == "--run")
+    {
+        options.run = true;
+    }
+    else if (argument == "--interpret")
+    {
+        options.interpret = true;
+    }
+    else if (argument.rfind("--jobs=", 0) == 0)
+    {
+        options.jobs = std::max(1, std::stoi(argument.substr(7)));
+    }
+    else if (argument.rfind("--inline-threshold=", 0) == 0)
+    {
+        options.inline_threshold = std::stoi(argument.substr(19));
+    }
+    else if (argument == "--no-cache")
+    {
+        options.cache = false;
+    }
+    else if (argument.rfind("--cache-dir=", 0) == 0)
+    {
+        options.cache_directory = argument.substr(12);
+    }
+    else if (argument.rfind("--cache-size=", 0) == 0)
+    {
+        options.cache_size = std::stoull(argument.substr(13));
+    }
+    else if (argument == "--cache-stats")
+    {
+        options.cache_statistics = true;
+    }
+    else if (argument == "--incremental")
+    {
+        options.incremental = true;
+    }
+    else if (argument == "--stats")
+    {
+        options.statistics = true;
+    }
+    else if (argument == "--stats=json")
+    {
+        options.statistics      = true;
+        options.statistics_json = true;
+    }
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+// NOTE: Everything that can be configured from the command line
+struct Options
+{
+    bool quiet{false};
+
+    // NOTE: -O0 keeps every value in memory, -O1 and -O2 use the linear scan
+    // register allocator and -O3 uses the slower graph coloring allocator
+    int optimization_level{0};
+
+    // NOTE: --calling-convention=sysv passes the first six arguments in
+    // rdi, rsi, rdx, rcx, r8 and r9 instead of pushing all of them
+    bool register_arguments{false};
+
+    // NOTE: Print how many values each register allocator had to spill for
+    // every function, to compare them
+    bool spill_report{false};
+
+    // NOTE: --inline-threshold=N. How many quads inlining a function is
+    // allowed to add to the caller at -O2 and above, 0 disables inlining of
+    // anything that isn't smaller than the call itself
+    int inline_threshold{16};
+
+    // NOTE: Print how many times each peephole rule fired, once everything
+    // has been compiled
+    bool peephole_report{false};
+
+    // NOTE: --emit=asm writes the program to out.asm and assembles and links
+    // it with nasm and ld, instead of writing the executable directly
+    bool emit_assembler{false};
+
+    // NOTE: --run executes the program inside of the compiler as soon as it
+    // has been compiled, without writing any files
+    bool run{false};
+
+    // NOTE: --interpret lowers the program to bytecode and runs it in the
+    // interpreter instead of generating any machine code
+    bool interpret{false};
+
+    // NOTE: --jobs=N generates the code of up to N functions at the same
+    // time. The output is the same as with one job. With -o DIR it is the
+    // number of files compiled at the same time instead, and 0 means one per
+    // hardware thread.
+    int jobs{0};
+
+    // NOTE: Executables are cached in cache_directory, and compiling a file
+    // that is already in it only copies the executable. --no-cache turns
+    // this off, --cache-size=N limits the cache to N MiB and --cache-stats
+    // prints how well it has worked.
+    bool           cache{true};
+    std::string    cache_directory{};
+    std::uintmax_t cache_size{256};
+    bool           cache_statistics{false};
+
+    // NOTE: --incremental keeps the code of every function next to the
+    // output, and only generates the functions that have changed since the
+    // last build of it
+    bool incremental{false};
+
+    // NOTE: --stats prints how long each phase took and how much it produced
+    // once a file has been compiled, --stats=json prints the same as a single
+    // line of JSON
+    bool statistics{false};
+    bool statistics_json{false};
+};
+
+// NOTE: Applies a single command line option. Anything that isn't one of the
+// options above is ignored.
+void parse_option(Options &options, std::string const &argument);
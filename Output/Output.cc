@@ -0,0 +1,57 @@
+#include "Output.h"
+#include <cstring>
+#include <iostream>
+
+Output::Output() : buffer(BUFFER_SIZE) {}
+
+void Output::print_integer(long value)
+{
+    char          digits[24];
+    int           start     = sizeof(digits);
+    unsigned long magnitude = value < 0 ? -(unsigned long)value : value;
+
+    digits[--start] = '\n';
+
+    do
+    {
+        digits[--start] = '0' + magnitude % 10;
+        magnitude /= 10;
+    } while (magnitude != 0);
+
+    if (value < 0)
+    {
+        digits[--start] = '-';
+    }
+
+    write(digits + start, sizeof(digits) - start);
+}
+
+void Output::print_bool(long value)
+{
+    if (value != 0)
+    {
+        write("true\n", 5);
+    }
+    else
+    {
+        write("false\n", 6);
+    }
+}
+
+void Output::flush()
+{
+    std::cout.write(buffer.data(), buffered);
+    std::cout.flush();
+    buffered = 0;
+}
+
+void Output::write(char const *text, std::size_t size)
+{
+    if (buffered + size > buffer.size())
+    {
+        flush();
+    }
+
+    std::memcpy(buffer.data() + buffered, text, size);
+    buffered += size;
+}
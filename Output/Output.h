@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+// NOTE: What a program prints when it isn't run as an executable, with --run
+// or --interpret. It prints exactly what the routines in print.asm print, and
+// is buffered the same way, so that both can be compared with the output of
+// the executable.
+class Output
+{
+  public:
+    Output();
+
+    void print_integer(long value);
+    void print_bool(long value);
+
+    // NOTE: Writes everything that has been buffered to stdout
+    void flush();
+
+  private:
+    void write(char const *text, std::size_t size);
+
+    std::vector<char> buffer;
+    std::size_t       buffered{0};
+
+    static constexpr std::size_t BUFFER_SIZE = 1 << 16;
+};
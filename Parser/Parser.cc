@@ -11,14 +11,32 @@
 #include <string>
 
 Parser::Parser(Tokenizer &tokenizer, SymbolTable *symbol_table,
-               TypeChecker &type_checker, Quads &quads,
-               CodeGenerator &code_generator)
+               TypeChecker &type_checker, Quads &quads, Optimizer &optimizer,
+               CodeGenerator     &code_generator,
+               BytecodeGenerator *bytecode_generator,
+               FunctionCache *function_cache, Statistics *statistics)
     : tokenizer{tokenizer}, symbol_table{symbol_table},
-      type_checker{type_checker}, quads{quads}, code_generator{code_generator}
+      type_checker{type_checker}, quads{quads}, optimizer{optimizer},
+      code_generator{code_generator}, bytecode_generator{bytecode_generator},
+      function_cache{function_cache}, statistics{statistics}
 {
     ASSERT(symbol_table != nullptr);
 }
 
+void Parser::generate_code()
+{
+    Statistics::Timer timer{statistics, "codegen"};
+
+    if (bytecode_generator != nullptr)
+    {
+        bytecode_generator->generate_bytecode(quads);
+    }
+    else
+    {
+        code_generator.generate_code(quads);
+    }
+}
+
 Token Parser::expect(Token::Kind kind)
 {
     Token next{tokenizer.peek(1)};
@@ -95,7 +113,10 @@ AST_Node *Parser::parse()
                                    symbol_table->type_bool);
     symbol_table->close_scope();
 
-    code_generator.generate_predefined_functions();
+    {
+        Statistics::Timer timer{statistics, "codegen"};
+        code_generator.generate_predefined_functions();
+    }
 
     AST_Node *expr = parse_statement_list();
 
@@ -135,8 +156,29 @@ AST_Node *Parser::parse()
     AST_Node *default_function =
         new AST_FunctionDefinition(no_location, name, nullptr, nullptr, body);
 
-    quads.generate_quads(default_function);
-    code_generator.generate_code(quads);
+    {
+        Statistics::Timer timer{statistics, "quads"};
+        quads.generate_quads(default_function);
+    }
+
+    {
+        Statistics::Timer timer{statistics, "optimize"};
+        optimizer.optimize(quads);
+    }
+
+    generate_code();
+
+    {
+        Statistics::Timer timer{statistics, "codegen"};
+        code_generator.finish();
+    }
+
+    if (statistics != nullptr)
+    {
+        statistics->add_count("quads", quads.get_quad_count());
+        statistics->add_count("instructions",
+                              code_generator.get_instruction_count());
+    }
 
     // NOTE: We are done, so this is not necessary. Just do it for closure.
     symbol_table->close_scope();
@@ -286,8 +328,12 @@ AST_Statement *Parser::parse_statement()
     // Function definition
     case Token::Kind::Function:
     {
+        int first_token = tokenizer.get_position();
+
         Token token_function = tokenizer.eat();
 
+        callees.clear();
+
         Token name_token = expect(Token::Kind::Identifier);
 
         int symbol_index =
@@ -358,9 +404,48 @@ AST_Statement *Parser::parse_statement()
         // stuff!
         // function_definition->print(std::cout, symbol_table, false, {});
         // symbol_table->print(std::cout);
-        type_checker.type_check(function_definition);
-        quads.generate_quads(function_definition);
-        code_generator.generate_code(quads);
+        {
+            Statistics::Timer timer{statistics, "type_check"};
+            type_checker.type_check(function_definition);
+        }
+
+        bool reuse = function_cache != nullptr &&
+                     function_cache->begin(
+                         symbol_index,
+                         tokenizer.get_text(first_token,
+                                            tokenizer.get_position()),
+                         callees);
+
+        // NOTE: The functions defined after this one may inline it, which
+        // they need its optimized quads for even if its code is reused
+        if (!reuse || optimizer.keeps_bodies())
+        {
+            {
+                Statistics::Timer timer{statistics, "quads"};
+                quads.generate_quads(function_definition);
+            }
+
+            Statistics::Timer timer{statistics, "optimize"};
+            optimizer.optimize(quads);
+        }
+
+        if (reuse)
+        {
+            // NOTE: Skip the quads, the code generator won't need them
+            quads.discard_pending_quads();
+
+            Statistics::Timer timer{statistics, "codegen"};
+            code_generator.reuse_code(function_cache->reuse(symbol_index));
+        }
+        else
+        {
+            if (function_cache != nullptr)
+            {
+                function_cache->end(symbol_index);
+            }
+
+            generate_code();
+        }
 
         symbol_table->close_scope();
 
@@ -774,5 +859,7 @@ AST_FunctionCall *Parser::parse_function_call()
                            "Symbol '" + symbol->name + "' is not a function");
     }
 
+    callees.insert(symbol_index);
+
     return new AST_FunctionCall(tok_name.location, ident, arguments);
 }
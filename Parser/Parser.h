@@ -2,22 +2,33 @@
 
 #include "AST/AST.h"
 #include "CodeGenerator/CodeGenerator.h"
+#include "Interpreter/BytecodeGenerator.h"
+#include "Optimizer/Optimizer.h"
 #include "Quads/Quads.h"
+#include "Statistics/Statistics.h"
 #include "SymbolTable/SymbolTable.h"
 #include "Tokenizer/Tokenizer.h"
 #include "TypeChecker/TypeChecker.h"
 #include <iostream>
+#include <set>
 
 class Parser
 {
   public:
-    Parser(Tokenizer &, SymbolTable *, TypeChecker &, Quads &, CodeGenerator &);
+    Parser(Tokenizer &, SymbolTable *, TypeChecker &, Quads &, Optimizer &,
+           CodeGenerator &, BytecodeGenerator *bytecode_generator = nullptr,
+           FunctionCache *function_cache = nullptr,
+           Statistics    *statistics     = nullptr);
 
     AST_Node *parse();
 
   private:
     Token expect(Token::Kind kind);
 
+    // NOTE: Hands the quads of the function that was just parsed to the code
+    // generator, or to the bytecode generator when interpreting
+    void generate_code();
+
     AST_Node *parse_start();
 
     AST_StatementList *parse_statement_list();
@@ -46,5 +57,13 @@ class Parser
     SymbolTable  *symbol_table;
     TypeChecker   type_checker;
     Quads         quads;
+    Optimizer     optimizer;
     CodeGenerator code_generator;
+
+    BytecodeGenerator *bytecode_generator;
+    FunctionCache     *function_cache;
+    Statistics        *statistics;
+
+    // NOTE: The functions called by the function that is being parsed
+    std::set<int> callees{};
 };
@@ -10,6 +10,83 @@ Quad::Quad(Operation operation, long operand1, long operand2, long dest)
     : operation{operation}, operand1{operand1}, operand2{operand2}, dest{dest}
 {}
 
+std::vector<long> Quad::uses() const
+{
+    switch (operation)
+    {
+    case Operation::I_ADD:
+    case Operation::I_MINUS:
+    case Operation::I_MULTIPLICATION:
+    case Operation::I_DIVISION:
+    case Operation::LESSER_THAN:
+    case Operation::LESSER_THAN_OR_EQUAL:
+    case Operation::EQUAL:
+    case Operation::GREATER_THAN:
+    case Operation::GREATER_THAN_OR_EQUAL: return {operand1, operand2};
+    case Operation::ASSIGN:
+    case Operation::ARGUMENT:
+    case Operation::UNARY_MINUS:
+    case Operation::I_MULTIPLICATION_IMMEDIATE:
+    case Operation::I_DIVISION_IMMEDIATE:
+    case Operation::IF: return {operand1};
+    case Operation::RETURN:
+    {
+        if (operand1 != -1)
+        {
+            return {operand1};
+        }
+
+        return {};
+    }
+    default: return {};
+    }
+}
+
+std::vector<long *> Quad::use_operands()
+{
+    switch (operation)
+    {
+    case Operation::I_ADD:
+    case Operation::I_MINUS:
+    case Operation::I_MULTIPLICATION:
+    case Operation::I_DIVISION:
+    case Operation::LESSER_THAN:
+    case Operation::LESSER_THAN_OR_EQUAL:
+    case Operation::EQUAL:
+    case Operation::GREATER_THAN:
+    case Operation::GREATER_THAN_OR_EQUAL: return {&operand1, &operand2};
+    case Operation::ASSIGN:
+    case Operation::ARGUMENT:
+    case Operation::UNARY_MINUS:
+    case Operation::I_MULTIPLICATION_IMMEDIATE:
+    case Operation::I_DIVISION_IMMEDIATE:
+    case Operation::IF: return {&operand1};
+    case Operation::RETURN:
+    {
+        if (operand1 != -1)
+        {
+            return {&operand1};
+        }
+
+        return {};
+    }
+    default: return {};
+    }
+}
+
+long Quad::definition() const
+{
+    switch (operation)
+    {
+    case Operation::ARGUMENT:
+    case Operation::LABEL:
+    case Operation::RETURN:
+    case Operation::IF:
+    case Operation::JUMP: return -1;
+    default: return dest;
+    }
+}
+
 Quads::Quads(SymbolTable *symbol_table) : symbol_table{symbol_table} {}
 
 void Quads::generate_quads(AST_Node *root) { root->generate_quads(this); }
@@ -28,18 +105,41 @@ Quad *Quads::get_current_quad()
     }
 }
 
+int Quads::get_quad_count() const { return quads.size(); }
+
+std::vector<Quad *> Quads::get_pending_quads() const
+{
+    return std::vector<Quad *>(quads.begin() + current_quad_index + 1,
+                               quads.end());
+}
+
+void Quads::replace_pending_quads(std::vector<Quad *> const &pending)
+{
+    quads.erase(quads.begin() + current_quad_index + 1, quads.end());
+    quads.insert(quads.end(), pending.begin(), pending.end());
+}
+
+void Quads::discard_pending_quads() { current_quad_index = quads.size() - 1; }
+
 void Quads::generate_argument_quads(AST_ExpressionList *arguments, int index)
 {
-    if (arguments == nullptr)
+    // NOTE: Evaluate every argument before passing any of them. That way the
+    // ARGUMENT quads end up right in front of the FUNCTION_CALL they belong
+    // to, without any other calls in between, which the code generator relies
+    // on when it passes arguments in registers.
+    std::vector<int> argument_locations{};
+
+    for (AST_ExpressionList *argument = arguments; argument != nullptr;
+         argument                     = argument->rest_expressions)
     {
-        return;
+        int location = argument->expression->generate_quads(this);
+        argument_locations.push_back(location);
     }
 
-    int argument_location = arguments->expression->generate_quads(this);
-
-    add_quad(new Quad(Quad::Operation::ARGUMENT, argument_location, index, -1));
-
-    generate_argument_quads(arguments->rest_expressions, ++index);
+    for (int location : argument_locations)
+    {
+        add_quad(new Quad(Quad::Operation::ARGUMENT, location, index++, -1));
+    }
 }
 
 int Quads::generate_binary_operation_quads(
@@ -98,6 +198,33 @@ int Quads::generate_binary_relation_quads(
     return dest;
 }
 
+bool is_tail_call(std::vector<Quad *> const &quads, int quad_index)
+{
+    Quad const *call = quads[quad_index];
+
+    if (call->operation != Quad::Operation::FUNCTION_CALL)
+    {
+        return false;
+    }
+
+    // NOTE: Labels don't generate any code, so a call followed only by labels
+    // falls through to the implicit return at the end of the function
+    for (int i = quad_index + 1; i < quads.size(); i++)
+    {
+        Quad const *next = quads[i];
+
+        if (next->operation == Quad::Operation::LABEL)
+        {
+            continue;
+        }
+
+        return next->operation == Quad::Operation::RETURN &&
+               (next->operand1 == -1 || next->operand1 == call->dest);
+    }
+
+    return true;
+}
+
 std::ostream &operator<<(std::ostream &os, Quads const &q)
 {
     for (int i = 0; i < q.quads.size(); i++)
@@ -122,6 +249,10 @@ std::ostream &operator<<(std::ostream &os, Quad::Operation const &op)
     case Quad::Operation::I_MINUS: return os << "minus";
     case Quad::Operation::I_MULTIPLICATION: return os << "multiplication";
     case Quad::Operation::I_DIVISION: return os << "division";
+    case Quad::Operation::I_MULTIPLICATION_IMMEDIATE:
+        return os << "multiplication immediate";
+    case Quad::Operation::I_DIVISION_IMMEDIATE:
+        return os << "division immediate";
     case Quad::Operation::I_STORE: return os << "store";
     case Quad::Operation::ASSIGN: return os << "assign";
     case Quad::Operation::ARGUMENT: return os << "argument";
@@ -129,8 +260,15 @@ std::ostream &operator<<(std::ostream &os, Quad::Operation const &op)
     case Quad::Operation::FUNCTION_CALL: return os << "function call";
     case Quad::Operation::RETURN: return os << "return";
     case Quad::Operation::UNARY_MINUS: return os << "unary minus";
+    case Quad::Operation::LESSER_THAN: return os << "lesser than";
+    case Quad::Operation::LESSER_THAN_OR_EQUAL:
+        return os << "lesser than or equal";
+    case Quad::Operation::EQUAL: return os << "equal";
     case Quad::Operation::GREATER_THAN: return os << "greater than";
+    case Quad::Operation::GREATER_THAN_OR_EQUAL:
+        return os << "greater than or equal";
     case Quad::Operation::IF: return os << "if";
+    case Quad::Operation::JUMP: return os << "jump";
     default: return os << "Unknown operation";
     }
 }
@@ -19,6 +19,11 @@ struct Quad
         I_MULTIPLICATION,
         I_DIVISION,
 
+        // NOTE: Multiplication and division by a known value, operand2 holds
+        // the value itself instead of a symbol
+        I_MULTIPLICATION_IMMEDIATE,
+        I_DIVISION_IMMEDIATE,
+
         // Binary relations
         LESSER_THAN,
         LESSER_THAN_OR_EQUAL,
@@ -34,10 +39,20 @@ struct Quad
         RETURN,
         UNARY_MINUS,
         IF,
+        JUMP,
     };
 
     Quad(Operation, long, long, long);
 
+    // NOTE: The symbol indices read by this quad and the one it writes, if
+    // any. Labels, immediate values and function symbols are not included.
+    std::vector<long> uses() const;
+    long              definition() const;
+
+    // NOTE: Same as uses(), but pointing into the quad so the operands can be
+    // rewritten in place
+    std::vector<long *> use_operands();
+
     // NOTE: Integer values, doubles and symbol table indices are stored as long
     Operation operation;
     long      operand1;
@@ -57,6 +72,18 @@ class Quads
 
     Quad *get_current_quad();
 
+    // NOTE: Every quad of every function so far, after optimizing
+    int get_quad_count() const;
+
+    // NOTE: The quads that haven't been handed to the code generator yet,
+    // which is the body of the function that is currently being compiled
+    std::vector<Quad *> get_pending_quads() const;
+    void                replace_pending_quads(std::vector<Quad *> const &);
+
+    // NOTE: Treats the pending quads as if they had been handed to the code
+    // generator, for functions whose code comes from somewhere else
+    void discard_pending_quads();
+
     void generate_argument_quads(AST_ExpressionList *arguments, int index);
     int  generate_binary_operation_quads(AST_BinaryOperation const *,
                                          Quad::Operation);
@@ -74,3 +101,7 @@ class Quads
 };
 
 std::ostream &operator<<(std::ostream &os, Quad::Operation const &op);
+
+// NOTE: Whether the quad at the given position is a call whose result is
+// immediately returned, so nothing in this function runs after it
+bool is_tail_call(std::vector<Quad *> const &quads, int quad_index);
@@ -0,0 +1,319 @@
+#include "Error/Error.h"
+#include "RegisterAllocator/Liveness.h"
+#include "RegisterAllocator/RegisterAllocator.h"
+#include <algorithm>
+
+GraphColoringAllocator::GraphColoringAllocator(SymbolTable *symbol_table)
+    : RegisterAllocator(symbol_table)
+{}
+
+void GraphColoringAllocator::add_edge(int a, int b)
+{
+    if (a != b)
+    {
+        graph[a].insert(b);
+        graph[b].insert(a);
+    }
+}
+
+int GraphColoringAllocator::find(int symbol_index)
+{
+    while (alias.count(symbol_index) == 1)
+    {
+        symbol_index = alias[symbol_index];
+    }
+
+    return symbol_index;
+}
+
+int GraphColoringAllocator::colors_available(int node) const
+{
+    if (crosses_call.count(node) == 1)
+    {
+        return callee_saved_registers.size();
+    }
+
+    return callee_saved_registers.size() + caller_saved_registers.size();
+}
+
+bool GraphColoringAllocator::can_coalesce(int a, int b) const
+{
+    // NOTE: Briggs' conservative test. Merging is safe if the combined node
+    // has fewer than K neighbours of significant degree, since all the others
+    // are guaranteed to be simplified away before it.
+    std::set<int> neighbours{graph.at(a)};
+    neighbours.insert(graph.at(b).begin(), graph.at(b).end());
+
+    int k = std::min(colors_available(a), colors_available(b));
+
+    int significant = 0;
+    for (int neighbour : neighbours)
+    {
+        if (graph.at(neighbour).size() >= colors_available(neighbour))
+        {
+            significant += 1;
+        }
+    }
+
+    return significant < k;
+}
+
+void GraphColoringAllocator::coalesce(int into, int from)
+{
+    for (int neighbour : graph[from])
+    {
+        graph[neighbour].erase(from);
+        add_edge(into, neighbour);
+    }
+
+    graph.erase(from);
+    alias[from] = into;
+
+    cost[into] += cost[from];
+    members[into].insert(members[from].begin(), members[from].end());
+
+    if (crosses_call.count(from) == 1)
+    {
+        crosses_call.insert(into);
+    }
+}
+
+Allocation
+GraphColoringAllocator::allocate(int                        function_index,
+                                 std::vector<Quad *> const &quads)
+{
+    // NOTE: Chaitin-Briggs graph coloring. We build an interference graph from
+    // the liveness information, conservatively coalesce the two sides of
+    // ASSIGN quads, simplify the graph onto a stack and then optimistically
+    // assign colors (registers) in reverse order. Anything that can't be
+    // colored is spilled to its stack slot.
+
+    graph.clear();
+    alias.clear();
+    cost.clear();
+    members.clear();
+    crosses_call.clear();
+
+    Liveness liveness{symbol_table, function_index, quads};
+
+    for (LiveInterval const &interval : liveness.get_intervals())
+    {
+        graph[interval.symbol_index];
+        members[interval.symbol_index].insert(interval.symbol_index);
+    }
+
+    // NOTE: All parameters arrive at the same time
+    for (int a : liveness.live_at_entry())
+    {
+        for (int b : liveness.live_at_entry())
+        {
+            add_edge(a, b);
+        }
+    }
+
+    std::vector<Quad *> moves{};
+
+    for (int q = 0; q < quads.size(); q++)
+    {
+        Quad const *quad = quads[q];
+        long        def  = quad->definition();
+
+        for (long use : quad->uses())
+        {
+            if (graph.count(use) == 1)
+            {
+                cost[use] += 1;
+            }
+        }
+
+        if (def != -1 && graph.count(def) == 1)
+        {
+            cost[def] += 1;
+
+            for (int live : liveness.live_after(q))
+            {
+                // NOTE: The source of a move doesn't interfere with its
+                // destination, they hold the same value
+                if (quad->operation == Quad::Operation::ASSIGN &&
+                    live == quad->operand1)
+                {
+                    continue;
+                }
+
+                add_edge(def, live);
+            }
+
+            if (quad->operation == Quad::Operation::ASSIGN &&
+                graph.count(quad->operand1) == 1)
+            {
+                moves.push_back(quads[q]);
+            }
+        }
+
+        if (quad->operation == Quad::Operation::FUNCTION_CALL)
+        {
+            for (int live : liveness.live_after(q))
+            {
+                if (live != def)
+                {
+                    crosses_call.insert(live);
+                }
+            }
+        }
+    }
+
+    bool changed = true;
+    while (changed)
+    {
+        changed = false;
+
+        for (Quad const *move : moves)
+        {
+            int a = find(move->dest);
+            int b = find(move->operand1);
+
+            if (a == b || graph[a].count(b) == 1 || !can_coalesce(a, b))
+            {
+                continue;
+            }
+
+            coalesce(a, b);
+            changed = true;
+        }
+    }
+
+    // NOTE: Simplify. Repeatedly remove a node with fewer neighbours than
+    // there are registers for it. If there is none, optimistically push the
+    // cheapest node to spill and hope it gets a color anyway.
+    //
+    // The nodes that can be removed and the spill costs of the others are
+    // kept sorted and updated as the degrees drop, instead of searching every
+    // node that is left each time. Degrees only ever drop, so a node that can
+    // be removed stays that way. Both are ordered by node on ties, so the
+    // nodes are removed in the same order as by a search.
+    std::map<int, int> degree{};
+    for (auto const &[node, neighbours] : graph)
+    {
+        degree[node] = neighbours.size();
+    }
+
+    auto get_spill_cost = [&](int node)
+    {
+        return (double)cost[node] / (degree[node] + 1);
+    };
+
+    std::set<int>                    simplifiable{};
+    std::set<std::pair<double, int>> spill_candidates{};
+
+    for (auto const &[node, node_degree] : degree)
+    {
+        if (node_degree < colors_available(node))
+        {
+            simplifiable.insert(node);
+        }
+        else
+        {
+            spill_candidates.insert({get_spill_cost(node), node});
+        }
+    }
+
+    std::vector<int> stack{};
+
+    while (!degree.empty())
+    {
+        int node{0};
+
+        if (!simplifiable.empty())
+        {
+            node = *simplifiable.begin();
+            simplifiable.erase(simplifiable.begin());
+        }
+        else
+        {
+            node = spill_candidates.begin()->second;
+            spill_candidates.erase(spill_candidates.begin());
+        }
+
+        degree.erase(node);
+        stack.push_back(node);
+
+        for (int neighbour : graph[node])
+        {
+            if (degree.count(neighbour) == 0)
+            {
+                continue;
+            }
+
+            if (simplifiable.count(neighbour) == 1)
+            {
+                degree[neighbour] -= 1;
+                continue;
+            }
+
+            spill_candidates.erase({get_spill_cost(neighbour), neighbour});
+            degree[neighbour] -= 1;
+
+            if (degree[neighbour] < colors_available(neighbour))
+            {
+                simplifiable.insert(neighbour);
+            }
+            else
+            {
+                spill_candidates.insert(
+                    {get_spill_cost(neighbour), neighbour});
+            }
+        }
+    }
+
+    // NOTE: Select. Prefer caller saved registers, which cost nothing to use
+    // as long as the value doesn't have to survive a call.
+    std::map<int, std::string> color{};
+    Allocation                 allocation{};
+
+    while (!stack.empty())
+    {
+        int node = stack.back();
+        stack.pop_back();
+
+        std::set<std::string> taken{};
+        for (int neighbour : graph[node])
+        {
+            if (color.count(neighbour) == 1)
+            {
+                taken.insert(color[neighbour]);
+            }
+        }
+
+        std::vector<std::string> candidates{};
+        if (crosses_call.count(node) == 0)
+        {
+            candidates = caller_saved_registers;
+        }
+        candidates.insert(candidates.end(), callee_saved_registers.begin(),
+                          callee_saved_registers.end());
+
+        for (std::string const &reg : candidates)
+        {
+            if (taken.count(reg) == 0)
+            {
+                color[node] = reg;
+                break;
+            }
+        }
+
+        if (color.count(node) == 0)
+        {
+            allocation.spill_count += members[node].size();
+            continue;
+        }
+
+        for (int member : members[node])
+        {
+            allocation.registers[member] = color[node];
+        }
+    }
+
+    finalize(allocation, liveness);
+
+    return allocation;
+}
@@ -0,0 +1,267 @@
+#include "Liveness.h"
+#include "Error/Error.h"
+#include "Quads/Quads.h"
+#include "SymbolTable/Symbol.h"
+#include "SymbolTable/SymbolTable.h"
+#include <algorithm>
+#include <map>
+
+Liveness::Liveness(SymbolTable *symbol_table, int function_index,
+                   std::vector<Quad *> const &quads)
+    : symbol_table{symbol_table}, function_index{function_index}, quads{quads}
+{
+    build_basic_blocks();
+    solve_dataflow();
+    compute_live_after();
+    build_intervals();
+}
+
+std::vector<LiveInterval> const &Liveness::get_intervals() const
+{
+    return intervals;
+}
+
+std::set<int> const &Liveness::live_after(int quad_index) const
+{
+    ASSERT(quad_index >= 0 && quad_index < live_after_quad.size());
+    return live_after_quad[quad_index];
+}
+
+std::set<int> const &Liveness::live_at_entry() const
+{
+    static std::set<int> const empty{};
+
+    if (blocks.empty())
+    {
+        return empty;
+    }
+
+    return blocks.front().live_in;
+}
+
+std::vector<int> const &Liveness::get_call_positions() const
+{
+    return call_positions;
+}
+
+bool Liveness::is_allocatable(long symbol_index) const
+{
+    // NOTE: Variables of an enclosing scope don't live in this function's
+    // activation record, so they can't be given a register either
+    return symbol_table->is_local(symbol_index, function_index);
+}
+
+void Liveness::build_basic_blocks()
+{
+    // NOTE: A new block starts at every label and right after every quad that
+    // can transfer control somewhere else
+    std::map<long, int> label_to_block{};
+
+    for (int i = 0; i < quads.size(); i++)
+    {
+        Quad *quad = quads[i];
+
+        bool is_leader = i == 0 || quad->operation == Quad::Operation::LABEL ||
+                         quads[i - 1]->operation == Quad::Operation::IF ||
+                         quads[i - 1]->operation == Quad::Operation::JUMP ||
+                         quads[i - 1]->operation == Quad::Operation::RETURN;
+
+        if (is_leader)
+        {
+            blocks.push_back(BasicBlock{i, i});
+        }
+        else
+        {
+            blocks.back().last_quad = i;
+        }
+
+        if (quad->operation == Quad::Operation::LABEL)
+        {
+            label_to_block[quad->operand1] = blocks.size() - 1;
+        }
+
+        if (quad->operation == Quad::Operation::FUNCTION_CALL)
+        {
+            call_positions.push_back(i);
+        }
+    }
+
+    for (int i = 0; i < blocks.size(); i++)
+    {
+        BasicBlock &block = blocks[i];
+        Quad       *last  = quads[block.last_quad];
+
+        if (last->operation == Quad::Operation::RETURN)
+        {
+            continue;
+        }
+
+        if (last->operation == Quad::Operation::JUMP)
+        {
+            ASSERT(label_to_block.count(last->operand1) == 1);
+            block.successors.push_back(label_to_block[last->operand1]);
+            continue;
+        }
+
+        if (last->operation == Quad::Operation::IF)
+        {
+            ASSERT(label_to_block.count(last->operand2) == 1);
+            block.successors.push_back(label_to_block[last->operand2]);
+        }
+
+        if (i + 1 < blocks.size())
+        {
+            block.successors.push_back(i + 1);
+        }
+    }
+}
+
+void Liveness::solve_dataflow()
+{
+    // NOTE: Standard backwards liveness analysis, iterated until nothing
+    // changes. Blocks are visited in reverse order since most edges go forward.
+    bool changed = true;
+
+    while (changed)
+    {
+        changed = false;
+
+        for (int i = blocks.size() - 1; i >= 0; i--)
+        {
+            BasicBlock &block = blocks[i];
+
+            std::set<int> live_out{};
+            for (int successor : block.successors)
+            {
+                live_out.insert(blocks[successor].live_in.begin(),
+                                blocks[successor].live_in.end());
+            }
+
+            std::set<int> live{live_out};
+            for (int q = block.last_quad; q >= block.first_quad; q--)
+            {
+                long def = quads[q]->definition();
+                if (is_allocatable(def))
+                {
+                    live.erase(def);
+                }
+
+                for (long use : quads[q]->uses())
+                {
+                    if (is_allocatable(use))
+                    {
+                        live.insert(use);
+                    }
+                }
+            }
+
+            if (live != block.live_in || live_out != block.live_out)
+            {
+                block.live_in  = live;
+                block.live_out = live_out;
+                changed        = true;
+            }
+        }
+    }
+}
+
+void Liveness::compute_live_after()
+{
+    live_after_quad.resize(quads.size());
+
+    for (BasicBlock const &block : blocks)
+    {
+        std::set<int> live{block.live_out};
+
+        for (int q = block.last_quad; q >= block.first_quad; q--)
+        {
+            live_after_quad[q] = live;
+
+            long def = quads[q]->definition();
+            if (is_allocatable(def))
+            {
+                live.erase(def);
+            }
+
+            for (long use : quads[q]->uses())
+            {
+                if (is_allocatable(use))
+                {
+                    live.insert(use);
+                }
+            }
+        }
+    }
+}
+
+void Liveness::build_intervals()
+{
+    std::map<int, LiveInterval> by_symbol{};
+
+    auto extend = [&](int symbol_index, int position)
+    {
+        auto it = by_symbol.find(symbol_index);
+
+        if (it == by_symbol.end())
+        {
+            by_symbol[symbol_index] =
+                LiveInterval{symbol_index, position, position};
+        }
+        else
+        {
+            it->second.start = std::min(it->second.start, position);
+            it->second.end   = std::max(it->second.end, position);
+        }
+    };
+
+    for (int q = 0; q < quads.size(); q++)
+    {
+        for (long use : quads[q]->uses())
+        {
+            if (is_allocatable(use))
+            {
+                extend(use, q);
+            }
+        }
+
+        long def = quads[q]->definition();
+        if (is_allocatable(def))
+        {
+            extend(def, q);
+        }
+
+        for (int symbol_index : live_after_quad[q])
+        {
+            extend(symbol_index, q);
+        }
+    }
+
+    // NOTE: Parameters that are read before being written get their value
+    // from the caller, so they have to be live from the very beginning
+    for (int symbol_index : live_at_entry())
+    {
+        if (symbol_table->get_symbol(symbol_index)->tag ==
+            Symbol::Tag::Parameter)
+        {
+            extend(symbol_index, -1);
+        }
+    }
+
+    for (auto &[symbol_index, interval] : by_symbol)
+    {
+        for (int call : call_positions)
+        {
+            if (interval.start < call && call < interval.end)
+            {
+                interval.crosses_call = true;
+                break;
+            }
+        }
+
+        intervals.push_back(interval);
+    }
+
+    std::stable_sort(intervals.begin(), intervals.end(),
+                     [](LiveInterval const &a, LiveInterval const &b)
+                     { return a.start < b.start; });
+}
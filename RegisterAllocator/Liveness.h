@@ -0,0 +1,70 @@
+#pragma once
+
+#include "Quads/Quads.h"
+#include "SymbolTable/SymbolTable.h"
+#include <set>
+#include <vector>
+
+struct LiveInterval
+{
+    int symbol_index;
+
+    // NOTE: Quad positions where the symbol is first and last live. Parameters
+    // are live from -1, since they are loaded in the function prologue.
+    int start;
+    int end;
+
+    // NOTE: If the value has to survive a function call it can only be kept in
+    // a callee saved register
+    bool crosses_call{false};
+};
+
+struct BasicBlock
+{
+    int first_quad;
+    int last_quad;
+
+    std::vector<int> successors{};
+
+    std::set<int> live_in{};
+    std::set<int> live_out{};
+};
+
+class Liveness
+{
+  public:
+    // NOTE: Only the variables and parameters of the function are tracked,
+    // everything else is left in memory
+    Liveness(SymbolTable *symbol_table, int function_index,
+             std::vector<Quad *> const &quads);
+
+    // NOTE: Sorted by increasing start position
+    std::vector<LiveInterval> const &get_intervals() const;
+
+    // NOTE: The symbols that are live right after the quad at the given
+    // position has been executed
+    std::set<int> const &live_after(int quad_index) const;
+
+    // NOTE: The symbols that are live when the function is entered, which
+    // should only ever be parameters
+    std::set<int> const &live_at_entry() const;
+
+    std::vector<int> const &get_call_positions() const;
+
+  private:
+    void build_basic_blocks();
+    void solve_dataflow();
+    void compute_live_after();
+    void build_intervals();
+
+    bool is_allocatable(long symbol_index) const;
+
+    SymbolTable               *symbol_table;
+    int                        function_index;
+    std::vector<Quad *> const &quads;
+
+    std::vector<BasicBlock>    blocks{};
+    std::vector<std::set<int>> live_after_quad{};
+    std::vector<LiveInterval>  intervals{};
+    std::vector<int>           call_positions{};
+};
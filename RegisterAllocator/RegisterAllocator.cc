@@ -0,0 +1,151 @@
+#include "RegisterAllocator.h"
+#include "Error/Error.h"
+#include "RegisterAllocator/Liveness.h"
+#include <algorithm>
+#include <set>
+
+std::vector<std::string> const RegisterAllocator::callee_saved_registers{
+    "rbx", "r12", "r13", "r14", "r15"};
+
+std::vector<std::string> const RegisterAllocator::caller_saved_registers{
+    "rsi", "rdi", "r8", "r9"};
+
+RegisterAllocator::RegisterAllocator(SymbolTable *symbol_table)
+    : symbol_table{symbol_table}
+{}
+
+RegisterAllocator::~RegisterAllocator() {}
+
+void RegisterAllocator::finalize(Allocation     &allocation,
+                                 Liveness const &liveness) const
+{
+    for (LiveInterval const &interval : liveness.get_intervals())
+    {
+        if (interval.start == -1 &&
+            allocation.registers.count(interval.symbol_index) == 1)
+        {
+            allocation.live_in_parameters.push_back(interval.symbol_index);
+        }
+    }
+
+    std::set<std::string> used{};
+    for (auto const &[symbol_index, reg] : allocation.registers)
+    {
+        used.insert(reg);
+    }
+
+    for (std::string const &reg : callee_saved_registers)
+    {
+        if (used.count(reg) == 1)
+        {
+            allocation.callee_saved.push_back(reg);
+        }
+    }
+}
+
+LinearScanAllocator::LinearScanAllocator(SymbolTable *symbol_table)
+    : RegisterAllocator(symbol_table)
+{}
+
+Allocation
+LinearScanAllocator::allocate(int                        function_index,
+                              std::vector<Quad *> const &quads)
+{
+    // NOTE: This is the classic linear scan by Poletto and Sarkar. We walk the
+    // live intervals in order of increasing start point and keep the ones that
+    // currently hold a register in 'active'. When we run out of registers we
+    // spill whichever interval ends last.
+
+    Liveness liveness{symbol_table, function_index, quads};
+
+    Allocation allocation{};
+
+    std::vector<std::string> free_callee_saved{callee_saved_registers};
+    std::vector<std::string> free_caller_saved{caller_saved_registers};
+
+    auto is_callee_saved = [](std::string const &reg)
+    {
+        return std::find(callee_saved_registers.begin(),
+                         callee_saved_registers.end(),
+                         reg) != callee_saved_registers.end();
+    };
+
+    auto release = [&](std::string const &reg)
+    {
+        if (is_callee_saved(reg))
+        {
+            free_callee_saved.push_back(reg);
+        }
+        else
+        {
+            free_caller_saved.push_back(reg);
+        }
+    };
+
+    // NOTE: Kept sorted by increasing end point
+    std::vector<LiveInterval> active{};
+
+    for (LiveInterval const &interval : liveness.get_intervals())
+    {
+        // NOTE: Expire intervals that are dead by the time this one starts. An
+        // interval that ends exactly where this one starts can hand over its
+        // register, since a quad reads its operands before writing its result.
+        while (!active.empty() && active.front().end <= interval.start)
+        {
+            release(allocation.registers[active.front().symbol_index]);
+            active.erase(active.begin());
+        }
+
+        std::string reg{""};
+
+        if (!interval.crosses_call && !free_caller_saved.empty())
+        {
+            reg = free_caller_saved.front();
+            free_caller_saved.erase(free_caller_saved.begin());
+        }
+        else if (!free_callee_saved.empty())
+        {
+            reg = free_callee_saved.front();
+            free_callee_saved.erase(free_callee_saved.begin());
+        }
+        else
+        {
+            // NOTE: Find the active interval that lives the longest and which
+            // holds a register this interval is allowed to use
+            auto victim = active.end();
+            for (auto it = active.begin(); it != active.end(); it++)
+            {
+                std::string const &candidate =
+                    allocation.registers[it->symbol_index];
+
+                if (!interval.crosses_call || is_callee_saved(candidate))
+                {
+                    victim = it;
+                }
+            }
+
+            if (victim == active.end() || victim->end <= interval.end)
+            {
+                allocation.spill_count += 1;
+                continue;
+            }
+
+            reg = allocation.registers[victim->symbol_index];
+            allocation.registers.erase(victim->symbol_index);
+            active.erase(victim);
+            allocation.spill_count += 1;
+        }
+
+        allocation.registers[interval.symbol_index] = reg;
+
+        auto position = std::upper_bound(
+            active.begin(), active.end(), interval,
+            [](LiveInterval const &a, LiveInterval const &b)
+            { return a.end < b.end; });
+        active.insert(position, interval);
+    }
+
+    finalize(allocation, liveness);
+
+    return allocation;
+}
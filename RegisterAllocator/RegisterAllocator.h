@@ -0,0 +1,78 @@
+#pragma once
+
+#include "Quads/Quads.h"
+#include "RegisterAllocator/Liveness.h"
+#include "SymbolTable/SymbolTable.h"
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+struct Allocation
+{
+    // NOTE: Symbols that are not in this map are spilled and live in their
+    // stack slot in the activation record
+    std::map<int, std::string> registers{};
+
+    // NOTE: The callee saved registers this function writes to, which the
+    // prologue and epilogue have to save and restore
+    std::vector<std::string> callee_saved{};
+
+    // NOTE: Parameters that have been given a register and hold the value
+    // passed by the caller, the prologue has to load these
+    std::vector<int> live_in_parameters{};
+
+    int spill_count{0};
+};
+
+class RegisterAllocator
+{
+  public:
+    RegisterAllocator(SymbolTable *symbol_table);
+    virtual ~RegisterAllocator();
+
+    virtual Allocation allocate(int                        function_index,
+                                std::vector<Quad *> const &quads) = 0;
+
+    // NOTE: Registers that survive a call, and registers that may be
+    // clobbered by one. Scratch registers used by the code generator (rax,
+    // rcx, rdx, r10 and r11) are never handed out.
+    static std::vector<std::string> const callee_saved_registers;
+    static std::vector<std::string> const caller_saved_registers;
+
+  protected:
+    void finalize(Allocation &allocation, Liveness const &liveness) const;
+
+    SymbolTable *symbol_table;
+};
+
+class LinearScanAllocator : public RegisterAllocator
+{
+  public:
+    LinearScanAllocator(SymbolTable *symbol_table);
+
+    Allocation allocate(int                        function_index,
+                        std::vector<Quad *> const &quads) override;
+};
+
+class GraphColoringAllocator : public RegisterAllocator
+{
+  public:
+    GraphColoringAllocator(SymbolTable *symbol_table);
+
+    Allocation allocate(int                        function_index,
+                        std::vector<Quad *> const &quads) override;
+
+  private:
+    void add_edge(int a, int b);
+    int  find(int symbol_index);
+    int  colors_available(int node) const;
+    bool can_coalesce(int a, int b) const;
+    void coalesce(int into, int from);
+
+    std::map<int, std::set<int>> graph{};
+    std::map<int, int>           alias{};
+    std::map<int, int>           cost{};
+    std::map<int, std::set<int>> members{};
+    std::set<int>                crosses_call{};
+};
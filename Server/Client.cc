@@ -0,0 +1,81 @@
+#include "Client.h"
+#include "Options/Options.h"
+#include "Server/Socket.h"
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+int compile_on_server(std::string const &path, std::string const &input,
+                      std::string const &output,
+                      std::vector<std::string> const &arguments)
+{
+    Options options{};
+    std::string request{};
+
+    for (std::string const &argument : arguments)
+    {
+        parse_option(options, argument);
+        request += argument + '\n';
+    }
+
+    request += '\n';
+
+    std::ifstream is{input, std::ifstream::binary};
+
+    if (!is)
+    {
+        std::cout << "Could not open '" << input << "'" << std::endl;
+        return 1;
+    }
+
+    std::stringstream source{};
+    source << is.rdbuf();
+
+    request += source.str();
+
+    int connection = connect_to(path);
+
+    write_all(connection, request);
+    shutdown(connection, SHUT_WR);
+
+    std::string response = read_all(connection);
+    close(connection);
+
+    if (response.size() < 9)
+    {
+        std::cout << "The server closed the connection" << std::endl;
+        return 1;
+    }
+
+    std::uint64_t size{0};
+    for (int i = 0; i < 8; i++)
+    {
+        size |= (std::uint64_t)(unsigned char)response[1 + i] << (8 * i);
+    }
+
+    std::cout << response.substr(9, size);
+
+    if (response[0] != '0')
+    {
+        return 1;
+    }
+
+    std::string file = options.emit_assembler ? output + ".asm" : output;
+
+    // NOTE: Replace the file instead of writing into it, in case the old
+    // executable is still running
+    std::remove(file.c_str());
+
+    std::ofstream{file, std::ofstream::binary} << response.substr(9 + size);
+
+    if (!options.emit_assembler)
+    {
+        chmod(file.c_str(), 0755);
+    }
+
+    return 0;
+}
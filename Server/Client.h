@@ -0,0 +1,11 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+// NOTE: Sends a file to a server and writes what it sends back to 'output',
+// or 'output' followed by .asm with --emit=asm. Returns the exit status the
+// compiler would have had.
+int compile_on_server(std::string const &path, std::string const &input,
+                      std::string const &output,
+                      std::vector<std::string> const &arguments);
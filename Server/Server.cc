@@ -0,0 +1,185 @@
+#include "Server.h"
+#include "Compiler/Compiler.h"
+#include "Error/Error.h"
+#include "Server/Socket.h"
+#include "ThreadPool/ThreadPool.h"
+#include <cerrno>
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <sstream>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace
+{
+
+// NOTE: What the forked process needs to send a failed response from the
+// exit handler, since errors exit the compiler wherever they happen
+int               response_connection{-1};
+std::stringstream messages{};
+
+void send_response(char status, std::string_view output)
+{
+    std::string header{status};
+
+    std::string text = messages.str();
+    for (int i = 0; i < 8; i++)
+    {
+        header.push_back((std::uint64_t)text.size() >> (8 * i));
+    }
+
+    write_all(response_connection, header);
+    write_all(response_connection, text);
+    write_all(response_connection, output);
+}
+
+void send_failure() { send_response('1', ""); }
+
+std::string compile(std::string const &source, Options const &options)
+{
+    std::unique_ptr<ThreadPool> thread_pool{};
+    if (options.jobs > 1)
+    {
+        thread_pool = std::make_unique<ThreadPool>(options.jobs);
+    }
+
+    return Compiler{options, thread_pool.get()}.compile(source);
+}
+
+} // namespace
+
+Server::Server(std::string const &path, Options const &options)
+    : path{path}, options{options}
+{
+    listener = listen_on(path);
+
+    // NOTE: The forked processes are never waited for
+    std::signal(SIGCHLD, SIG_IGN);
+
+    // NOTE: Compile something once so that the code and the allocator have
+    // been warmed up in the server, instead of in every forked process
+    Options warm_up_options{options};
+    warm_up_options.peephole_report = false;
+    warm_up_options.spill_report    = false;
+
+    compile("function main()\n{\n    print(1)\n}\n", warm_up_options);
+}
+
+Server::~Server()
+{
+    close(listener);
+    unlink(path.c_str());
+}
+
+void Server::run()
+{
+    if (!options.quiet)
+    {
+        std::cout << "Listening on " << path << std::endl;
+    }
+
+    while (true)
+    {
+        int connection = accept(listener, nullptr, nullptr);
+
+        if (connection == -1)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+
+            report_internal_compiler_error(
+                std::string{"Could not accept connection: "} +
+                std::strerror(errno));
+        }
+
+        pid_t pid = fork();
+
+        if (pid == 0)
+        {
+            close(listener);
+            handle(connection);
+        }
+
+        if (pid == -1)
+        {
+            std::cout << "Could not fork: " << std::strerror(errno)
+                      << std::endl;
+        }
+
+        close(connection);
+    }
+}
+
+void Server::handle(int connection)
+{
+    response_connection = connection;
+    std::cout.rdbuf(messages.rdbuf());
+    std::atexit(send_failure);
+
+    std::string request = read_all(connection);
+
+    Options request_options{options};
+    request_options.quiet = true;
+
+    std::size_t begin = 0;
+    while (true)
+    {
+        std::size_t end = request.find('\n', begin);
+
+        if (end == std::string::npos)
+        {
+            std::cout << "Malformed request" << std::endl;
+            std::exit(1);
+        }
+
+        std::string argument = request.substr(begin, end - begin);
+        begin                = end + 1;
+
+        if (argument.empty())
+        {
+            break;
+        }
+
+        parse_option(request_options, argument);
+    }
+
+    if (request_options.run || request_options.interpret)
+    {
+        std::cout << "The server can't run programs" << std::endl;
+        std::exit(1);
+    }
+
+    // NOTE: The response has no room for the statistics, and the server
+    // keeps neither a cache nor the functions of the previous build. Turning
+    // the cache off is the only cache option it can honour.
+    if (request_options.statistics)
+    {
+        std::cout << "The server can't print statistics" << std::endl;
+        std::exit(1);
+    }
+
+    if (request_options.incremental)
+    {
+        std::cout << "The server can't compile incrementally" << std::endl;
+        std::exit(1);
+    }
+
+    if (request_options.cache_directory != options.cache_directory ||
+        request_options.cache_size != options.cache_size ||
+        request_options.cache_statistics)
+    {
+        std::cout << "The server can't use the cache" << std::endl;
+        std::exit(1);
+    }
+
+    std::string output = compile(request.substr(begin), request_options);
+
+    send_response('0', output);
+
+    // NOTE: Skips the exit handler, which would send a second response
+    _exit(0);
+}
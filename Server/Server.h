@@ -0,0 +1,39 @@
+#pragma once
+
+#include "Options/Options.h"
+#include <string>
+
+// NOTE: Compiles programs sent to it over a Unix socket, for build systems
+// that would otherwise start the compiler once per file.
+//
+// A request is the command line options, one per line, then an empty line
+// and then the source, until the client shuts down its end of the socket.
+// The response is a single byte, '0' if the program compiled and '1' if it
+// didn't, the length of the compiler's messages as 8 little endian bytes, the
+// messages themselves and then the executable, or the assembler with
+// --emit=asm.
+//
+// Every request is compiled in a process forked from the server, so clients
+// are served at the same time and an error that exits the compiler only ends
+// that request. The forked process starts out with everything the server has
+// already loaded and allocated.
+class Server
+{
+  public:
+    Server(std::string const &path, Options const &options);
+    ~Server();
+
+    Server(Server const &)            = delete;
+    Server &operator=(Server const &) = delete;
+
+    // NOTE: Serves requests until the process is killed
+    void run();
+
+  private:
+    void handle(int connection);
+
+    std::string path;
+    Options     options;
+
+    int listener{-1};
+};
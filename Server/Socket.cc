@@ -0,0 +1,124 @@
+#include "Socket.h"
+#include "Error/Error.h"
+#include <cerrno>
+#include <cstring>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace
+{
+
+sockaddr_un make_address(std::string const &path)
+{
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+
+    if (path.size() >= sizeof(address.sun_path))
+    {
+        report_internal_compiler_error("Socket path is too long: '" + path +
+                                       "'");
+    }
+
+    std::strcpy(address.sun_path, path.c_str());
+    return address;
+}
+
+int open_socket()
+{
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+
+    if (fd == -1)
+    {
+        report_internal_compiler_error(std::string{"Could not open socket: "} +
+                                       std::strerror(errno));
+    }
+
+    return fd;
+}
+
+} // namespace
+
+int listen_on(std::string const &path)
+{
+    sockaddr_un address = make_address(path);
+    int         fd      = open_socket();
+
+    // NOTE: A server that didn't shut down cleanly leaves the file behind
+    unlink(path.c_str());
+
+    if (bind(fd, (sockaddr *)&address, sizeof(address)) == -1 ||
+        listen(fd, SOMAXCONN) == -1)
+    {
+        report_internal_compiler_error("Could not listen on '" + path +
+                                       "': " + std::strerror(errno));
+    }
+
+    return fd;
+}
+
+int connect_to(std::string const &path)
+{
+    sockaddr_un address = make_address(path);
+    int         fd      = open_socket();
+
+    if (connect(fd, (sockaddr *)&address, sizeof(address)) == -1)
+    {
+        report_internal_compiler_error("Could not connect to '" + path +
+                                       "': " + std::strerror(errno));
+    }
+
+    return fd;
+}
+
+void write_all(int fd, std::string_view data)
+{
+    while (!data.empty())
+    {
+        ssize_t written = write(fd, data.data(), data.size());
+
+        if (written == -1 && errno == EINTR)
+        {
+            continue;
+        }
+
+        if (written <= 0)
+        {
+            report_internal_compiler_error(
+                std::string{"Could not write to socket: "} +
+                std::strerror(errno));
+        }
+
+        data.remove_prefix(written);
+    }
+}
+
+std::string read_all(int fd)
+{
+    std::string data{};
+    char        buffer[1 << 16];
+
+    while (true)
+    {
+        ssize_t count = read(fd, buffer, sizeof(buffer));
+
+        if (count == -1 && errno == EINTR)
+        {
+            continue;
+        }
+
+        if (count == -1)
+        {
+            report_internal_compiler_error(
+                std::string{"Could not read from socket: "} +
+                std::strerror(errno));
+        }
+
+        if (count == 0)
+        {
+            return data;
+        }
+
+        data.append(buffer, count);
+    }
+}
@@ -0,0 +1,13 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+
+// NOTE: Helpers for the Unix sockets that the server and client talk over.
+// Both ends report any failure as an internal compiler error.
+
+int listen_on(std::string const &path);
+int connect_to(std::string const &path);
+
+void        write_all(int fd, std::string_view data);
+std::string read_all(int fd);
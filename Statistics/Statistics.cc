@@ -0,0 +1,168 @@
+#include "Statistics.h"
+#include <algorithm>
+#include <iomanip>
+#include <sys/resource.h>
+
+namespace
+{
+
+template <typename T>
+void add(std::vector<std::pair<std::string, T>> &values,
+         std::string const &name, T value)
+{
+    auto it =
+        std::find_if(values.begin(), values.end(),
+                     [&](auto const &pair) { return pair.first == name; });
+
+    if (it == values.end())
+    {
+        values.push_back({name, value});
+    }
+    else
+    {
+        it->second += value;
+    }
+}
+
+// NOTE: Only quotes and backslashes are escaped, which is enough for the
+// names of phases, counters and files
+std::string quote(std::string const &text)
+{
+    std::string quoted{"\""};
+
+    for (char c : text)
+    {
+        if (c == '"' || c == '\\')
+        {
+            quoted.push_back('\\');
+        }
+
+        quoted.push_back(c);
+    }
+
+    return quoted + "\"";
+}
+
+} // namespace
+
+Statistics::Timer::Timer(Statistics *statistics, char const *phase)
+    : statistics{statistics}, phase{phase}
+{
+    if (statistics == nullptr)
+    {
+        return;
+    }
+
+    parent              = statistics->current;
+    statistics->current = this;
+
+    start = std::chrono::steady_clock::now();
+}
+
+Statistics::Timer::~Timer()
+{
+    if (statistics == nullptr)
+    {
+        return;
+    }
+
+    std::chrono::duration<double> time =
+        std::chrono::steady_clock::now() - start;
+
+    statistics->add_time(phase, (time - inner_time).count());
+
+    if (parent != nullptr)
+    {
+        parent->inner_time += time;
+    }
+
+    statistics->current = parent;
+}
+
+void Statistics::add_time(std::string const &phase, double seconds)
+{
+    add(times, phase, seconds);
+}
+
+void Statistics::add_count(std::string const &counter, long count)
+{
+    add(counts, counter, count);
+}
+
+void Statistics::count_peak_memory()
+{
+    rusage usage{};
+    getrusage(RUSAGE_SELF, &usage);
+
+    // NOTE: Linux reports it in KiB
+    add_count("peak_rss_bytes", usage.ru_maxrss * 1024L);
+}
+
+void Statistics::print(std::ostream &os, std::string const &file) const
+{
+    // NOTE: Wide enough for the longest optimization pass
+    constexpr int NAME_WIDTH = 32;
+
+    double total{0};
+    for (auto const &[phase, seconds] : times)
+    {
+        total += seconds;
+    }
+
+    os << "Statistics for " << file << ":" << std::endl;
+
+    for (auto const &[phase, seconds] : times)
+    {
+        os << "\t" << std::left << std::setw(NAME_WIDTH) << phase << std::right
+           << std::fixed << std::setprecision(6) << seconds << " s  "
+           << std::setw(5) << std::setprecision(1)
+           << (total > 0 ? 100 * seconds / total : 0.0) << "%" << std::endl;
+    }
+
+    os << "\t" << std::left << std::setw(NAME_WIDTH) << "total" << std::right
+       << std::fixed << std::setprecision(6) << total << " s" << std::endl;
+
+    for (auto const &[counter, count] : counts)
+    {
+        os << "\t" << std::left << std::setw(NAME_WIDTH) << counter
+           << std::right << count << std::endl;
+    }
+}
+
+void Statistics::print_json(std::ostream &os, std::string const &file) const
+{
+    // NOTE: A single line per file, so that a batch compile prints one JSON
+    // object per line
+    os << "{\"file\": " << quote(file) << ", \"seconds\": {";
+
+    for (int i = 0; i < times.size(); i++)
+    {
+        os << (i > 0 ? ", " : "") << quote(times[i].first) << ": "
+           << std::fixed << std::setprecision(9) << times[i].second;
+    }
+
+    os << "}, \"counts\": {";
+
+    for (int i = 0; i < counts.size(); i++)
+    {
+        os << (i > 0 ? ", " : "") << quote(counts[i].first) << ": "
+           << counts[i].second;
+    }
+
+    os << "}}" << std::endl;
+}
+
+double Statistics::get_time(std::string const &phase) const
+{
+    double total{0};
+
+    for (auto const &[name, seconds] : times)
+    {
+        if (name == phase || name.rfind(phase + ".", 0) == 0)
+        {
+            total += seconds;
+        }
+    }
+
+    return total;
+}
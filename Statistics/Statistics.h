@@ -0,0 +1,58 @@
+#pragma once
+
+#include <chrono>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+// NOTE: How long each phase of compiling a file took and how much it
+// produced, printed with --stats or --stats=json. A phase that runs once per
+// function, like type checking, is the total of every time it ran.
+class Statistics
+{
+  public:
+    // NOTE: Adds the time until it goes out of scope to a phase. Timers can
+    // be nested, and the time spent in the inner timers is only counted for
+    // their own phases, so that the phases add up to the whole compile.
+    // Without statistics, nothing is measured.
+    class Timer
+    {
+      public:
+        Timer(Statistics *statistics, char const *phase);
+        ~Timer();
+
+        Timer(Timer const &)            = delete;
+        Timer &operator=(Timer const &) = delete;
+
+      private:
+        Statistics *statistics;
+        char const *phase;
+        Timer      *parent{nullptr};
+
+        std::chrono::steady_clock::time_point start{};
+        std::chrono::duration<double>         inner_time{0};
+    };
+
+    void add_time(std::string const &phase, double seconds);
+    void add_count(std::string const &counter, long count);
+
+    // NOTE: Peak resident set size of the whole process, since the start
+    void count_peak_memory();
+
+    void print(std::ostream &os, std::string const &file) const;
+    void print_json(std::ostream &os, std::string const &file) const;
+
+    // NOTE: The seconds spent in a phase and the phases named after it, like
+    // optimize.inlining for optimize
+    double get_time(std::string const &phase) const;
+
+  private:
+    // NOTE: In the order they were first added in
+    std::vector<std::pair<std::string, double>> times{};
+    std::vector<std::pair<std::string, long>>   counts{};
+
+    // NOTE: The innermost timer that is running. Statistics are only ever
+    // measured from the thread that is compiling the file.
+    Timer *current{nullptr};
+};
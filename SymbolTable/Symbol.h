@@ -52,6 +52,10 @@ class FunctionSymbol : public Symbol
     int activation_record_size{0};
 
     bool has_return{false};
+
+    // NOTE: Set by the optimizer for functions whose result only depends on
+    // their arguments, i.e. that never print anything
+    bool is_pure{false};
 };
 
 class ParameterSymbol : public Symbol
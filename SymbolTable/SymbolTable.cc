@@ -7,7 +7,6 @@
 
 SymbolTable::SymbolTable()
 {
-    std::fill(std::begin(symbol_table), std::end(symbol_table), nullptr);
     std::fill(std::begin(block_table), std::end(block_table), -1);
     std::fill(std::begin(hash_table), std::end(hash_table), -1);
 
@@ -26,12 +25,9 @@ SymbolTable::SymbolTable()
 
 SymbolTable::~SymbolTable()
 {
-    for (int i{0}; i < MAX_SYMBOLS; ++i)
+    for (int i{0}; i <= current_symbol_index; ++i)
     {
-        if (symbol_table[i] != nullptr)
-        {
-            delete symbol_table[i];
-        }
+        delete slot(i);
     }
 }
 
@@ -40,7 +36,7 @@ void SymbolTable::print(std::ostream &os)
     std::cout << "Symbol table: " << std::endl;
     for (int i{0}; i <= current_symbol_index; i++)
     {
-        os << i << ": " << *symbol_table[i] << std::endl;
+        os << i << ": " << *slot(i) << std::endl;
     }
 
     std::cout << std::endl;
@@ -68,13 +64,17 @@ int SymbolTable::generate_temporary_variable(int type)
 
 int SymbolTable::get_next_label() { return ++current_label_number; }
 
+int SymbolTable::get_symbol_count() const { return current_symbol_index + 1; }
+
+int SymbolTable::get_label_count() const { return current_label_number; }
+
 void SymbolTable::update_name(int index, std::string const &name)
 {
     int found_index = lookup_symbol(name);
 
     if (found_index != -1 &&
-        ((symbol_table[found_index]->level == current_level) ||
-         symbol_table[found_index]->tag == Symbol::Tag::Type))
+        ((slot(found_index)->level == current_level) ||
+         slot(found_index)->tag == Symbol::Tag::Type))
     {
         // TODO: Better error message
         report_parse_error(no_location, "Better error message");
@@ -100,7 +100,7 @@ int SymbolTable::insert_type(Location const &location, const std::string &name,
 {
     int symbol_index = insert_symbol(location, name, Symbol::Tag::Type);
 
-    Symbol *symbol = symbol_table[symbol_index];
+    Symbol *symbol = slot(symbol_index);
 
     if (symbol->tag != Symbol::Tag::Undefined)
     {
@@ -126,7 +126,7 @@ int SymbolTable::insert_variable(Location const    &location,
 {
     int symbol_index = insert_symbol(location, name, Symbol::Tag::Variable);
 
-    Symbol *symbol = symbol_table[symbol_index];
+    Symbol *symbol = slot(symbol_index);
 
     if (symbol->tag != Symbol::Tag::Undefined)
     {
@@ -159,7 +159,7 @@ int SymbolTable::insert_function(Location const    &location,
 {
     int symbol_index = insert_symbol(location, name, Symbol::Tag::Function);
 
-    Symbol *symbol = symbol_table[symbol_index];
+    Symbol *symbol = slot(symbol_index);
 
     if (symbol->tag != Symbol::Tag::Undefined)
     {
@@ -188,7 +188,7 @@ int SymbolTable::insert_parameter(Location const    &location,
 {
     int symbol_index = insert_symbol(location, name, Symbol::Tag::Parameter);
 
-    Symbol *symbol = symbol_table[symbol_index];
+    Symbol *symbol = slot(symbol_index);
 
     if (symbol->tag != Symbol::Tag::Undefined)
     {
@@ -257,8 +257,8 @@ int SymbolTable::insert_symbol(Location const    &location,
         int symbol_index = lookup_symbol(name);
 
         if (symbol_index != -1 &&
-            ((symbol_table[symbol_index]->level == current_level) ||
-             symbol_table[symbol_index]->tag == Symbol::Tag::Type))
+            ((slot(symbol_index)->level == current_level) ||
+             slot(symbol_index)->tag == Symbol::Tag::Type))
         {
             // NOTE: A symbol with the same name already exists on the same
             // level, so instead of creating a new one we return the already
@@ -310,7 +310,15 @@ int SymbolTable::insert_symbol(Location const    &location,
         report_internal_compiler_error("Maximum amount of symbols exceeded");
     }
 
-    symbol_table[current_symbol_index] = symbol;
+    std::unique_ptr<Symbol *[]> &block =
+        symbol_table[current_symbol_index / SYMBOL_BLOCK_SIZE];
+
+    if (block == nullptr)
+    {
+        block = std::make_unique<Symbol *[]>(SYMBOL_BLOCK_SIZE);
+    }
+
+    slot(current_symbol_index) = symbol;
 
     int previous_index     = hash_table[hash(name)];
     hash_table[hash(name)] = current_symbol_index;
@@ -338,7 +346,7 @@ int SymbolTable::lookup_symbol(const std::string &name) const
 
     while (found_index != -1)
     {
-        Symbol *symbol = symbol_table[found_index];
+        Symbol *symbol = slot(found_index);
 
         if (symbol->name == name)
         {
@@ -387,14 +395,14 @@ ParameterSymbol *SymbolTable::get_parameter_symbol(int symbol_index) const
 
 Symbol *SymbolTable::get_symbol(int symbol_index) const
 {
-    Symbol *symbol = symbol_table[symbol_index];
+    Symbol *symbol = slot(symbol_index);
     ASSERT(symbol != nullptr);
     return symbol;
 }
 
 Symbol *SymbolTable::remove_symbol(int symbol_index)
 {
-    Symbol *symbol     = symbol_table[symbol_index];
+    Symbol *symbol     = slot(symbol_index);
     int     hash_value = hash(symbol->name);
 
     if (hash_table[hash_value] == symbol_index)
@@ -406,19 +414,44 @@ Symbol *SymbolTable::remove_symbol(int symbol_index)
     return symbol;
 }
 
+bool SymbolTable::is_local(long symbol_index, int function_index) const
+{
+    if (symbol_index == -1)
+    {
+        return false;
+    }
+
+    Symbol *symbol = slot(symbol_index);
+
+    if (symbol->tag == Symbol::Tag::Parameter)
+    {
+        return get_parameter_symbol(symbol_index)->function == function_index;
+    }
+
+    return symbol->tag == Symbol::Tag::Variable &&
+           symbol->level - 1 == get_function_symbol(function_index)->level;
+}
+
+Symbol *&SymbolTable::slot(int symbol_index) const
+{
+    return symbol_table[symbol_index / SYMBOL_BLOCK_SIZE]
+                       [symbol_index % SYMBOL_BLOCK_SIZE];
+}
+
 int SymbolTable::hash(const std::string &name) const
 {
     // Source:
     // https://www.cs.hmc.edu/~geoff/classes/hmc.cs070.200101/homework10/hashfuncs.html
 
-    int h{0};
+    // NOTE: Unsigned, so that long names can't make the hash negative
+    unsigned int h{0};
 
     for (char c : name)
     {
-        int highorder = h & 0xf8000000;
-        h             = h << 5;
-        h             = h ^ (highorder >> 27);
-        h             = h ^ c;
+        unsigned int highorder = h & 0xf8000000;
+        h                      = h << 5;
+        h                      = h ^ (highorder >> 27);
+        h                      = h ^ (unsigned char)c;
     }
 
     return h % MAX_HASH_VALUE;
@@ -449,7 +482,7 @@ int SymbolTable::enclosing_scope() const { return block_table[current_level]; }
 std::string SymbolTable::get_name(int symbol_index)
 {
     ASSERT(symbol_index >= 0);
-    Symbol *symbol = symbol_table[symbol_index];
+    Symbol *symbol = slot(symbol_index);
     ASSERT(symbol != nullptr);
     return symbol->name;
 }
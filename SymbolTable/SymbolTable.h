@@ -4,6 +4,7 @@
 #include "SymbolTable/SymbolTable.h"
 #include <array>
 #include <iostream>
+#include <memory>
 #include <string>
 
 class SymbolTable
@@ -26,6 +27,11 @@ class SymbolTable
     ParameterSymbol *get_parameter_symbol(int symbol_index) const;
 
     int     lookup_symbol(const std::string &name) const;
+
+    // NOTE: Whether the symbol is a variable or parameter of the function.
+    // Variables declared in an enclosing scope, like the ones at the top
+    // level, belong to the function of that scope.
+    bool is_local(long symbol_index, int function_index) const;
     Symbol *remove_symbol(int symbol_index);
 
     void open_scope();
@@ -35,6 +41,10 @@ class SymbolTable
 
     int  generate_temporary_variable(int type);
     int  get_next_label();
+
+    // NOTE: The number of symbols and labels that have been created so far
+    int get_symbol_count() const;
+    int get_label_count() const;
     void update_name(int, std::string const &);
 
     void print(std::ostream &os);
@@ -51,20 +61,30 @@ class SymbolTable
   private:
     int hash(const std::string &name) const;
 
+    // NOTE: Where the symbol with the given index is stored
+    Symbol *&slot(int symbol_index) const;
+
     // TODO: Use vector instead of array and reserve these values to begin with,
     // instead of setting hard upper limit
     static const int MAX_HASH_VALUE = 1024;
-    static const int MAX_SYMBOLS    = 1024;
     static const int MAX_LEVELS     = 1024;
 
-    std::array<Symbol *, MAX_SYMBOLS> symbol_table{};
-    std::array<int, MAX_LEVELS>       block_table{};
-    std::array<int, MAX_HASH_VALUE>   hash_table{};
+    // NOTE: The symbols are stored in blocks that are allocated as they are
+    // needed. A symbol never moves once it has been inserted, since the code
+    // of earlier functions is generated on other threads while new symbols
+    // are inserted.
+    static const int SYMBOL_BLOCK_SIZE = 1024;
+    static const int MAX_SYMBOL_BLOCKS = 1024;
+    static const int MAX_SYMBOLS = SYMBOL_BLOCK_SIZE * MAX_SYMBOL_BLOCKS;
+
+    std::array<std::unique_ptr<Symbol *[]>, MAX_SYMBOL_BLOCKS> symbol_table{};
+    std::array<int, MAX_LEVELS>                               block_table{};
+    std::array<int, MAX_HASH_VALUE>                           hash_table{};
 
     int current_symbol_index{-1};
     int current_level{0};
     int current_temporary_variable_number{-1};
-    int current_label_number;
+    int current_label_number{0};
 
     Location no_location{Location{-1, -1, -1}};
 };
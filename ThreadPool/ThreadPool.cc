@@ -0,0 +1,131 @@
+#include "ThreadPool.h"
+#include "Error/Error.h"
+
+ThreadPool::ThreadPool(int thread_count)
+{
+    ASSERT(thread_count > 0);
+
+    for (int i = 0; i < thread_count; i++)
+    {
+        queues.push_back(std::make_unique<Queue>());
+    }
+
+    for (int i = 0; i < thread_count; i++)
+    {
+        threads.emplace_back(&ThreadPool::work, this, i);
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock{mutex};
+        stopping = true;
+    }
+
+    task_available.notify_all();
+
+    for (std::thread &thread : threads)
+    {
+        thread.join();
+    }
+}
+
+void ThreadPool::submit(std::function<void()> task)
+{
+    int index{0};
+    {
+        std::lock_guard<std::mutex> lock{mutex};
+        index      = next_queue;
+        next_queue = (next_queue + 1) % queues.size();
+    }
+
+    {
+        std::lock_guard<std::mutex> lock{queues[index]->mutex};
+        queues[index]->tasks.push_back(std::move(task));
+    }
+
+    // NOTE: Only counted once it is in a queue, so that a worker that sees
+    // the count go up is guaranteed to find the task
+    {
+        std::lock_guard<std::mutex> lock{mutex};
+        queued += 1;
+        unfinished += 1;
+    }
+
+    task_available.notify_one();
+}
+
+void ThreadPool::wait()
+{
+    std::unique_lock<std::mutex> lock{mutex};
+    tasks_finished.wait(lock, [this] { return unfinished == 0; });
+}
+
+int ThreadPool::get_thread_count() const { return threads.size(); }
+
+void ThreadPool::work(int index)
+{
+    while (true)
+    {
+        {
+            std::unique_lock<std::mutex> lock{mutex};
+            task_available.wait(lock,
+                                [this] { return stopping || queued > 0; });
+
+            if (queued == 0)
+            {
+                return;
+            }
+        }
+
+        std::function<void()> task{};
+        if (!take(index, task))
+        {
+            // NOTE: Another worker got to it first
+            continue;
+        }
+
+        task();
+
+        std::lock_guard<std::mutex> lock{mutex};
+        unfinished -= 1;
+
+        if (unfinished == 0)
+        {
+            tasks_finished.notify_all();
+        }
+    }
+}
+
+bool ThreadPool::take(int index, std::function<void()> &task)
+{
+    for (int i = 0; i < queues.size(); i++)
+    {
+        Queue &queue = *queues[(index + i) % queues.size()];
+
+        std::lock_guard<std::mutex> lock{queue.mutex};
+        if (queue.tasks.empty())
+        {
+            continue;
+        }
+
+        // NOTE: The newest task from our own queue, the oldest from others
+        if (i == 0)
+        {
+            task = std::move(queue.tasks.back());
+            queue.tasks.pop_back();
+        }
+        else
+        {
+            task = std::move(queue.tasks.front());
+            queue.tasks.pop_front();
+        }
+
+        std::lock_guard<std::mutex> counter_lock{mutex};
+        queued -= 1;
+        return true;
+    }
+
+    return false;
+}
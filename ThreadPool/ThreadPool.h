@@ -0,0 +1,57 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// NOTE: A fixed number of worker threads that run the tasks they are given.
+// Every worker has a queue of its own and takes the newest task from it, and
+// a worker whose queue is empty steals the oldest task from one of the others.
+// That way a few long tasks don't hold up the short ones queued behind them.
+class ThreadPool
+{
+  public:
+    ThreadPool(int thread_count);
+    ~ThreadPool();
+
+    ThreadPool(ThreadPool const &)            = delete;
+    ThreadPool &operator=(ThreadPool const &) = delete;
+
+    void submit(std::function<void()> task);
+
+    // NOTE: Blocks until every task that has been submitted has finished
+    void wait();
+
+    int get_thread_count() const;
+
+  private:
+    struct Queue
+    {
+        std::mutex                        mutex{};
+        std::deque<std::function<void()>> tasks{};
+    };
+
+    void work(int index);
+
+    // NOTE: Takes a task from the worker's own queue, or steals one
+    bool take(int index, std::function<void()> &task);
+
+    std::vector<std::unique_ptr<Queue>> queues{};
+    std::vector<std::thread>            threads{};
+
+    // NOTE: Protects the counters below, which the condition variables wait
+    // on. 'queued' is the number of tasks waiting in a queue, 'unfinished' the
+    // number that have been submitted but haven't finished yet.
+    std::mutex              mutex{};
+    std::condition_variable task_available{};
+    std::condition_variable tasks_finished{};
+
+    int  queued{0};
+    int  unfinished{0};
+    int  next_queue{0};
+    bool stopping{false};
+};
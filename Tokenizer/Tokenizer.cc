@@ -394,3 +394,20 @@ Token Tokenizer::peek() { return peek(1); }
 Token Tokenizer::peek(int n) { return tokens[token_index + n]; }
 
 Token Tokenizer::eat() { return tokens[++token_index]; }
+
+int Tokenizer::get_position() const { return token_index + 1; }
+
+int Tokenizer::get_token_count() const { return tokens.size(); }
+
+std::string Tokenizer::get_text(int begin, int end) const
+{
+    std::string text{};
+
+    for (int i = begin; i < end; i++)
+    {
+        text += std::to_string((int)tokens[i].kind) + " " + tokens[i].text;
+        text += '\n';
+    }
+
+    return text;
+}
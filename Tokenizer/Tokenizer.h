@@ -15,6 +15,15 @@ class Tokenizer
     Token peek(int i);
     Token eat();
 
+    // NOTE: The index of the next token that will be eaten
+    int get_position() const;
+
+    int get_token_count() const;
+
+    // NOTE: The tokens from 'begin' up to 'end', in a form where two ranges
+    // are equal only if their tokens are
+    std::string get_text(int begin, int end) const;
+
     void print(std::ostream &os);
 
   private: